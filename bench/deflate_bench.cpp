@@ -0,0 +1,94 @@
+// Round-trips deflateIndependent through inflateZlib and measures its throughput. The
+// round trips cover the block boundaries (inputs around kMaxBlockSymbols literals, which
+// once ended the stream with two BFINAL blocks) and pieces concatenated with sync flushes
+// like the PNG writer does; any mismatch fails the run. Built with
+// -DRAYTRACER_BUILD_BENCHMARKS=ON.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "image/deflate.h"
+
+namespace {
+
+using namespace imageio;
+
+// compresses 'data' as 'pieces' independent pieces into one zlib stream
+std::vector<uint8_t> compress(const std::vector<uint8_t> &data, size_t pieces) {
+  std::vector<uint8_t> stream = {0x78, 0x01};
+  const size_t step = (data.size() + pieces - 1) / pieces;
+  for (size_t p = 0; p < pieces; ++p) {
+    const size_t begin = std::min(data.size(), p * step);
+    const size_t end = std::min(data.size(), begin + step);
+    deflateIndependent(data.data() + begin, end - begin, p + 1 == pieces, stream);
+  }
+  const uint32_t adler = adler32(data.data(), data.size());
+  for (int shift = 24; shift >= 0; shift -= 8)
+    stream.push_back(static_cast<uint8_t>(adler >> shift));
+  return stream;
+}
+
+bool roundTrip(const char *what, const std::vector<uint8_t> &data, size_t pieces) {
+  const std::vector<uint8_t> stream = compress(data, pieces);
+  std::vector<uint8_t> back;
+  std::string error;
+  if (!inflateZlib(stream.data(), stream.size(), back, data.size(), error) || back != data) {
+    std::printf("FAILED: %s, %zu bytes in %zu pieces: %s\n", what, data.size(), pieces,
+                error.empty() ? "data mismatch" : error.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<uint8_t> randomBytes(size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(n);
+  for (uint8_t &c : data)
+    c = static_cast<uint8_t>(rng());
+  return data;
+}
+
+// smooth gradient with noise, roughly what the PNG writer sees after filtering
+std::vector<uint8_t> imageLike(size_t n) {
+  std::mt19937 rng(3);
+  std::vector<uint8_t> data(n);
+  for (size_t i = 0; i < n; ++i)
+    data[i] = static_cast<uint8_t>((i / 3 % 1024) / 4 + (rng() & 3));
+  return data;
+}
+
+bool check() {
+  bool ok = roundTrip("empty", {}, 1);
+  ok &= roundTrip("one byte", {42}, 1);
+  // random bytes are (almost) all literals, so these sizes put the end of the input at and
+  // next to a full block
+  for (size_t n = kMaxBlockSymbols - 4; n <= kMaxBlockSymbols + 4; ++n) {
+    ok &= roundTrip("random, one piece", randomBytes(n, 1), 1);
+    ok &= roundTrip("random, two pieces", randomBytes(2 * n, 2), 2);
+  }
+  ok &= roundTrip("random, several blocks", randomBytes(3 * kMaxBlockSymbols, 3), 1);
+  ok &= roundTrip("image-like", imageLike(1 << 20), 1);
+  ok &= roundTrip("image-like, 16 pieces", imageLike(1 << 20), 16);
+  return ok;
+}
+
+void run() {
+  const std::vector<uint8_t> data = imageLike(size_t(64) << 20);
+  const auto start = std::chrono::steady_clock::now();
+  const std::vector<uint8_t> stream = compress(data, 1);
+  const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("deflate: %.1f MB/s, ratio %.3f\n", data.size() / s / (1 << 20),
+              static_cast<double>(stream.size()) / data.size());
+}
+
+} // namespace
+
+int main() {
+  if (!check())
+    return 1;
+  std::printf("round trips ok\n");
+  run();
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Compares the texel layouts of Texture: bilinear lookups over a synthetic texture along
+// different access patterns. The large texture measures memory behaviour, the small one fits
+// into the caches and measures the filter itself (compile with -DRAYTRACER_NO_SIMD for the
+// scalar filter). Built with -DRAYTRACER_BUILD_BENCHMARKS=ON.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "scene/textures/texture.h"
+
+namespace {
+
+constexpr int kSamples = 1 << 22;
+
+struct Pattern {
+  const char *name;
+  // texture coordinate of lookup i on a size x size texture
+  void (*uv)(int i, int size, float &u, float &v);
+};
+
+// one texel step per lookup, like a camera ray sweep over a textured floor
+void horizontal(int i, int size, float &u, float &v) {
+  u = static_cast<float>(i % size) / size;
+  v = static_cast<float>(i / size) / size;
+}
+
+void vertical(int i, int size, float &u, float &v) {
+  horizontal(i, size, v, u);
+}
+
+void diagonal(int i, int size, float &u, float &v) {
+  const float t = static_cast<float>(i % size) / size;
+  const float offset = static_cast<float>(i / size) / size;
+  u = t + offset;
+  v = t;
+}
+
+void random(int i, int, float &u, float &v) {
+  // cheap hash instead of an RNG in the timed loop
+  uint32_t h = static_cast<uint32_t>(i) * 2654435761u;
+  u = static_cast<float>(h & 0xffff) / 65536.f;
+  h ^= h >> 15;
+  h *= 2246822519u;
+  v = static_cast<float>(h & 0xffff) / 65536.f;
+}
+
+void run(int size) {
+  std::vector<uint8_t> rgba(static_cast<size_t>(size) * size * 4);
+  std::mt19937 rng(7);
+  for (uint8_t &c : rgba)
+    c = static_cast<uint8_t>(rng());
+
+  const Pattern patterns[] = {{"horizontal", horizontal}, {"vertical", vertical}, {"diagonal", diagonal}, {"random", random}};
+  const struct {
+    const char *name;
+    TextureLayout layout;
+  } layouts[] = {{"rowmajor", TextureLayout::ROW_MAJOR}, {"tiled", TextureLayout::TILED}, {"zorder", TextureLayout::Z_ORDER}};
+
+  std::printf("%dx%d texture\n%-10s", size, size, "ns/lookup");
+  for (const Pattern &p : patterns)
+    std::printf(" %10s", p.name);
+  std::printf("\n");
+
+  for (const auto &l : layouts) {
+    Texture texture("bench", l.layout);
+    texture.setTexels(size, size, rgba);
+
+    std::printf("%-10s", l.name);
+    for (const Pattern &p : patterns) {
+      Color sum{};
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < kSamples; ++i) {
+        float u, v;
+        p.uv(i, size, u, v);
+        sum += texture.sample(u, v);
+      }
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      // print the sum so the loop is not optimized away
+      std::printf(" %10.2f", ns / kSamples + 0.f * (sum.x + sum.y + sum.z));
+    }
+    std::printf("\n");
+  }
+}
+
+} // namespace
+
+int main() {
+  run(4096);
+  run(256);
+  return 0;
+}
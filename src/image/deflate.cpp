@@ -0,0 +1,689 @@
+#include "image/deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <queue>
+
+namespace imageio {
+
+namespace {
+
+constexpr int kWindowSize = 32768;
+constexpr int kMinMatch = 4; // hashed prefix, deflate itself allows 3
+constexpr int kMaxMatch = 258;
+constexpr int kHashBits = 15;
+constexpr int kMaxCodeLength = 15;
+constexpr int kMaxCodeLengthCodeLength = 7;
+// upper bound of output bytes per input byte: a 258 byte match takes at least two bits
+constexpr size_t kMaxExpansion = 1032;
+
+// length codes 257..285: base length and extra bits (RFC 1951, 3.2.5)
+constexpr uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+struct Tables {
+  std::array<uint32_t, 256> crc{};
+  std::array<uint8_t, 259> lengthCode{}; // match length -> index into kLengthBase
+  std::array<uint8_t, 512> distCodeSmall{}; // (distance - 1) < 256 and (distance - 1) >> 7 otherwise
+
+  Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      crc[i] = c;
+    }
+    for (int code = 0; code < 29; ++code) {
+      const int end = code == 28 ? 259 : kLengthBase[code + 1];
+      for (int len = kLengthBase[code]; len < end; ++len)
+        lengthCode[len] = static_cast<uint8_t>(code);
+    }
+    lengthCode[258] = 28;
+    for (int code = 0; code < 30; ++code) {
+      const int end = code == 29 ? 32769 : kDistBase[code + 1];
+      for (int d = kDistBase[code]; d < end; ++d) {
+        if (d - 1 < 256)
+          distCodeSmall[d - 1] = static_cast<uint8_t>(code);
+        else
+          distCodeSmall[256 + ((d - 1) >> 7)] = static_cast<uint8_t>(code);
+      }
+    }
+  }
+};
+
+const Tables &tables() {
+  static const Tables t;
+  return t;
+}
+
+int distanceCode(int dist) {
+  const Tables &t = tables();
+  return dist - 1 < 256 ? t.distCodeSmall[dist - 1] : t.distCodeSmall[256 + ((dist - 1) >> 7)];
+}
+
+// LSB-first bit writer as required by deflate
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+  void put(uint32_t bits, int count) {
+    buffer_ |= static_cast<uint64_t>(bits) << count_;
+    count_ += count;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<uint8_t>(buffer_));
+      buffer_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  void align() {
+    if (count_ > 0)
+      put(0, 8 - count_);
+  }
+
+private:
+  std::vector<uint8_t> &out_;
+  uint64_t buffer_ = 0;
+  int count_ = 0;
+};
+
+// LZ77 output: literal (dist == 0) or match
+struct Symbol {
+  uint16_t litOrLength;
+  uint16_t dist;
+};
+
+// Huffman code lengths limited to maxLength; rare symbols are flattened until the tree fits
+void buildCodeLengths(const std::vector<uint32_t> &freq, int maxLength, std::vector<uint8_t> &lengths) {
+  const size_t n = freq.size();
+  lengths.assign(n, 0);
+  std::vector<uint32_t> f = freq;
+
+  for (;;) {
+    struct Node {
+      uint64_t weight;
+      int index; // < n: leaf symbol, otherwise internal node
+    };
+    auto cmp = [](const Node &a, const Node &b) { return a.weight > b.weight; };
+    std::priority_queue<Node, std::vector<Node>, decltype(cmp)> heap(cmp);
+    std::vector<int> parent;
+
+    int used = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (f[i] > 0) {
+        heap.push({f[i], static_cast<int>(i)});
+        ++used;
+      }
+    }
+    if (used == 0)
+      return;
+    if (used == 1) {
+      // a single code still needs one bit
+      for (size_t i = 0; i < n; ++i)
+        if (f[i] > 0)
+          lengths[i] = 1;
+      return;
+    }
+
+    parent.assign(n, -1);
+    while (heap.size() > 1) {
+      const Node a = heap.top();
+      heap.pop();
+      const Node b = heap.top();
+      heap.pop();
+      const int internal = static_cast<int>(parent.size());
+      parent.push_back(-1);
+      parent[a.index] = internal;
+      parent[b.index] = internal;
+      heap.push({a.weight + b.weight, internal});
+    }
+
+    int maxDepth = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (f[i] == 0)
+        continue;
+      int depth = 0;
+      for (int p = parent[i]; p != -1; p = parent[p])
+        ++depth;
+      lengths[i] = static_cast<uint8_t>(std::min(depth, 255));
+      maxDepth = std::max(maxDepth, depth);
+    }
+    if (maxDepth <= maxLength)
+      return;
+
+    for (uint32_t &v : f)
+      if (v > 0)
+        v = std::max(1u, v >> 1);
+  }
+}
+
+// Canonical codes (RFC 1951, 3.2.2), bit-reversed for the LSB-first writer
+void buildCodes(const std::vector<uint8_t> &lengths, std::vector<uint16_t> &codes) {
+  uint16_t count[kMaxCodeLength + 1] = {};
+  for (uint8_t l : lengths)
+    if (l)
+      ++count[l];
+  uint16_t next[kMaxCodeLength + 1] = {};
+  uint16_t code = 0;
+  for (int bits = 1; bits <= kMaxCodeLength; ++bits) {
+    code = static_cast<uint16_t>((code + count[bits - 1]) << 1);
+    next[bits] = code;
+  }
+  codes.assign(lengths.size(), 0);
+  for (size_t i = 0; i < lengths.size(); ++i) {
+    const int l = lengths[i];
+    if (!l)
+      continue;
+    uint16_t c = next[l]++;
+    uint16_t reversed = 0;
+    for (int b = 0; b < l; ++b) {
+      reversed = static_cast<uint16_t>((reversed << 1) | (c & 1));
+      c >>= 1;
+    }
+    codes[i] = reversed;
+  }
+}
+
+void writeDynamicBlock(const std::vector<Symbol> &symbols, bool final, BitWriter &bw) {
+  std::vector<uint32_t> litFreq(286, 0), distFreq(30, 0);
+  for (const Symbol &s : symbols) {
+    if (s.dist == 0) {
+      ++litFreq[s.litOrLength];
+    } else {
+      ++litFreq[257 + tables().lengthCode[s.litOrLength]];
+      ++distFreq[distanceCode(s.dist)];
+    }
+  }
+  litFreq[256] = 1; // end of block
+
+  // some decoders reject an empty distance tree, keep at least two codes
+  int distUsed = 0;
+  for (uint32_t v : distFreq)
+    distUsed += v > 0;
+  if (distUsed < 2) {
+    distFreq[0] = std::max(distFreq[0], 1u);
+    distFreq[1] = std::max(distFreq[1], 1u);
+  }
+
+  std::vector<uint8_t> litLen, distLen;
+  buildCodeLengths(litFreq, kMaxCodeLength, litLen);
+  buildCodeLengths(distFreq, kMaxCodeLength, distLen);
+
+  int hlit = 286;
+  while (hlit > 257 && litLen[hlit - 1] == 0)
+    --hlit;
+  int hdist = 30;
+  while (hdist > 1 && distLen[hdist - 1] == 0)
+    --hdist;
+
+  // run length encode the concatenated code lengths with symbols 16/17/18
+  std::vector<uint8_t> all(litLen.begin(), litLen.begin() + hlit);
+  all.insert(all.end(), distLen.begin(), distLen.begin() + hdist);
+  struct ClSymbol {
+    uint8_t sym;
+    uint8_t extra;
+  };
+  std::vector<ClSymbol> cl;
+  for (size_t i = 0; i < all.size();) {
+    const uint8_t v = all[i];
+    size_t run = 1;
+    while (i + run < all.size() && all[i + run] == v)
+      ++run;
+    if (v == 0 && run >= 3) {
+      const size_t r = std::min<size_t>(run, 138);
+      if (r >= 11)
+        cl.push_back({18, static_cast<uint8_t>(r - 11)});
+      else
+        cl.push_back({17, static_cast<uint8_t>(r - 3)});
+      i += r;
+    } else if (v != 0 && run >= 4) {
+      cl.push_back({v, 0});
+      const size_t r = std::min<size_t>(run - 1, 6);
+      cl.push_back({16, static_cast<uint8_t>(r - 3)});
+      i += 1 + r;
+    } else {
+      cl.push_back({v, 0});
+      ++i;
+    }
+  }
+
+  std::vector<uint32_t> clFreq(19, 0);
+  for (const ClSymbol &c : cl)
+    ++clFreq[c.sym];
+  std::vector<uint8_t> clLen;
+  buildCodeLengths(clFreq, kMaxCodeLengthCodeLength, clLen);
+  int hclen = 19;
+  while (hclen > 4 && clLen[kCodeLengthOrder[hclen - 1]] == 0)
+    --hclen;
+
+  std::vector<uint16_t> litCodes, distCodes, clCodes;
+  buildCodes(litLen, litCodes);
+  buildCodes(distLen, distCodes);
+  buildCodes(clLen, clCodes);
+
+  bw.put(final ? 1 : 0, 1);
+  bw.put(2, 2); // dynamic Huffman
+  bw.put(static_cast<uint32_t>(hlit - 257), 5);
+  bw.put(static_cast<uint32_t>(hdist - 1), 5);
+  bw.put(static_cast<uint32_t>(hclen - 4), 4);
+  for (int i = 0; i < hclen; ++i)
+    bw.put(clLen[kCodeLengthOrder[i]], 3);
+  for (const ClSymbol &c : cl) {
+    bw.put(clCodes[c.sym], clLen[c.sym]);
+    if (c.sym == 16)
+      bw.put(c.extra, 2);
+    else if (c.sym == 17)
+      bw.put(c.extra, 3);
+    else if (c.sym == 18)
+      bw.put(c.extra, 7);
+  }
+
+  for (const Symbol &s : symbols) {
+    if (s.dist == 0) {
+      bw.put(litCodes[s.litOrLength], litLen[s.litOrLength]);
+      continue;
+    }
+    const int lc = tables().lengthCode[s.litOrLength];
+    bw.put(litCodes[257 + lc], litLen[257 + lc]);
+    bw.put(static_cast<uint32_t>(s.litOrLength - kLengthBase[lc]), kLengthExtra[lc]);
+    const int dc = distanceCode(s.dist);
+    bw.put(distCodes[dc], distLen[dc]);
+    bw.put(static_cast<uint32_t>(s.dist - kDistBase[dc]), kDistExtra[dc]);
+  }
+  bw.put(litCodes[256], litLen[256]);
+}
+
+// LSB-first bit reader over the compressed input, reads zero bits past the end
+// (checked by the caller through overrun())
+class BitReader {
+public:
+  BitReader(const uint8_t *data, size_t n) : data_(data), n_(n) {}
+
+  uint32_t peek(int count) {
+    refill();
+    return static_cast<uint32_t>(buffer_ & ((uint64_t(1) << count) - 1));
+  }
+
+  void consume(int count) {
+    buffer_ >>= count;
+    count_ -= count;
+  }
+
+  uint32_t get(int count) {
+    const uint32_t v = peek(count);
+    consume(count);
+    return v;
+  }
+
+  void align() {
+    consume(count_ & 7);
+  }
+
+  bool overrun() const {
+    return count_ < 0 || pos_ - static_cast<size_t>(count_ / 8) > n_;
+  }
+
+  // byte position after align(), the bits still buffered are given back
+  size_t bytePosition() const {
+    return pos_ - static_cast<size_t>(count_ / 8);
+  }
+
+  void seek(size_t pos) {
+    pos_ = pos;
+    buffer_ = 0;
+    count_ = 0;
+  }
+
+private:
+  void refill() {
+    while (count_ <= 56) {
+      const uint64_t byte = pos_ < n_ ? data_[pos_] : 0;
+      ++pos_;
+      buffer_ |= byte << count_;
+      count_ += 8;
+    }
+  }
+
+  const uint8_t *data_;
+  size_t n_;
+  size_t pos_ = 0;
+  uint64_t buffer_ = 0;
+  int count_ = 0;
+};
+
+// Single level lookup table indexed by the next maxLength input bits: symbol << 4 | length
+class HuffmanDecoder {
+public:
+  void build(const uint8_t *lengths, int count) {
+    maxLength_ = 0;
+    for (int i = 0; i < count; ++i)
+      maxLength_ = std::max<int>(maxLength_, lengths[i]);
+    if (maxLength_ == 0) {
+      // an empty tree is legal (e.g. no distance codes), decoding from it is an error
+      table_.assign(1, 0);
+      return;
+    }
+
+    std::vector<uint8_t> l(lengths, lengths + count);
+    std::vector<uint16_t> codes;
+    buildCodes(l, codes);
+    table_.assign(size_t(1) << maxLength_, 0);
+    for (int sym = 0; sym < count; ++sym) {
+      const int len = lengths[sym];
+      if (!len)
+        continue;
+      for (size_t i = codes[sym]; i < table_.size(); i += size_t(1) << len)
+        table_[i] = static_cast<uint32_t>(sym << 4 | len);
+    }
+  }
+
+  // -1 for bit patterns not assigned to any code
+  int decode(BitReader &br) const {
+    const uint32_t entry = table_[br.peek(maxLength_)];
+    if (entry == 0)
+      return -1;
+    br.consume(static_cast<int>(entry & 15));
+    return static_cast<int>(entry >> 4);
+  }
+
+private:
+  int maxLength_ = 0;
+  std::vector<uint32_t> table_;
+};
+
+struct FixedTrees {
+  HuffmanDecoder lit;
+  HuffmanDecoder dist;
+
+  FixedTrees() {
+    uint8_t lengths[288 + 30];
+    std::fill(lengths, lengths + 144, 8);
+    std::fill(lengths + 144, lengths + 256, 9);
+    std::fill(lengths + 256, lengths + 280, 7);
+    std::fill(lengths + 280, lengths + 288, 8);
+    std::fill(lengths + 288, lengths + 318, 5);
+    lit.build(lengths, 288);
+    dist.build(lengths + 288, 30);
+  }
+};
+
+const FixedTrees &fixedTrees() {
+  static const FixedTrees trees;
+  return trees;
+}
+
+bool readDynamicTrees(BitReader &br, HuffmanDecoder &lit, HuffmanDecoder &dist, std::string &outError) {
+  const int hlit = static_cast<int>(br.get(5)) + 257;
+  const int hdist = static_cast<int>(br.get(5)) + 1;
+  const int hclen = static_cast<int>(br.get(4)) + 4;
+  uint8_t clLengths[19] = {};
+  for (int i = 0; i < hclen; ++i)
+    clLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(br.get(3));
+  HuffmanDecoder cl;
+  cl.build(clLengths, 19);
+
+  uint8_t lengths[286 + 30] = {};
+  for (int i = 0; i < hlit + hdist;) {
+    const int sym = cl.decode(br);
+    int repeat = 0;
+    uint8_t value = 0;
+    if (sym < 0) {
+      outError = "Invalid code length code.";
+      return false;
+    } else if (sym < 16) {
+      lengths[i++] = static_cast<uint8_t>(sym);
+      continue;
+    } else if (sym == 16) {
+      if (i == 0) {
+        outError = "Code length repeat without previous length.";
+        return false;
+      }
+      value = lengths[i - 1];
+      repeat = 3 + static_cast<int>(br.get(2));
+    } else if (sym == 17) {
+      repeat = 3 + static_cast<int>(br.get(3));
+    } else {
+      repeat = 11 + static_cast<int>(br.get(7));
+    }
+    if (i + repeat > hlit + hdist) {
+      outError = "Code lengths exceed the alphabet.";
+      return false;
+    }
+    while (repeat--)
+      lengths[i++] = value;
+  }
+  if (lengths[256] == 0) {
+    outError = "Missing end of block code.";
+    return false;
+  }
+  lit.build(lengths, hlit);
+  dist.build(lengths + hlit, hdist);
+  return true;
+}
+
+// 'limit' is the largest size 'out' may grow to
+bool inflateBlock(BitReader &br, const HuffmanDecoder &lit, const HuffmanDecoder &dist, std::vector<uint8_t> &out,
+                  size_t limit, std::string &outError) {
+  for (;;) {
+    const int sym = lit.decode(br);
+    if (sym < 0 || sym > 285 || br.overrun()) {
+      outError = "Invalid literal/length code.";
+      return false;
+    }
+    if (sym < 256) {
+      if (out.size() >= limit) {
+        outError = "Decompressed data exceeds the expected size.";
+        return false;
+      }
+      out.push_back(static_cast<uint8_t>(sym));
+      continue;
+    }
+    if (sym == 256)
+      return true;
+
+    const int lc = sym - 257;
+    const size_t length = kLengthBase[lc] + br.get(kLengthExtra[lc]);
+    const int dc = dist.decode(br);
+    if (dc < 0 || dc >= 30) {
+      outError = "Invalid distance code.";
+      return false;
+    }
+    const size_t distance = kDistBase[dc] + br.get(kDistExtra[dc]);
+    if (distance > out.size()) {
+      outError = "Distance reaches before the start of the data.";
+      return false;
+    }
+    if (length > limit - out.size()) {
+      outError = "Decompressed data exceeds the expected size.";
+      return false;
+    }
+    // byte by byte, source and destination overlap for distance < length
+    const size_t at = out.size();
+    out.resize(at + length);
+    uint8_t *dst = out.data() + at;
+    const uint8_t *src = dst - distance;
+    for (size_t k = 0; k < length; ++k)
+      dst[k] = src[k];
+  }
+}
+
+uint32_t hash4(const uint8_t *p) {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+} // namespace
+
+uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc) {
+  const auto &t = tables().crc;
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i)
+    crc = t[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+uint32_t adler32(const uint8_t *data, size_t n, uint32_t adler) {
+  constexpr uint32_t kMod = 65521;
+  uint32_t a = adler & 0xffff, b = adler >> 16;
+  while (n > 0) {
+    // 5552 is the largest block for which the sums cannot overflow before the modulo
+    const size_t block = std::min<size_t>(n, 5552);
+    for (size_t i = 0; i < block; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= kMod;
+    b %= kMod;
+    data += block;
+    n -= block;
+  }
+  return (b << 16) | a;
+}
+
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t lengthB) {
+  constexpr uint64_t kMod = 65521;
+  const uint64_t rem = lengthB % kMod;
+  const uint64_t a1 = adlerA & 0xffff, b1 = adlerA >> 16;
+  const uint64_t a2 = adlerB & 0xffff, b2 = adlerB >> 16;
+  const uint64_t a = (a1 + a2 + kMod - 1) % kMod;
+  const uint64_t b = (b1 + b2 + rem * a1 % kMod + kMod - rem) % kMod;
+  return static_cast<uint32_t>((b << 16) | a);
+}
+
+void deflateIndependent(const uint8_t *data, size_t n, bool last, std::vector<uint8_t> &out) {
+  BitWriter bw(out);
+  std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+  std::vector<Symbol> symbols;
+  symbols.reserve(std::min(n, kMaxBlockSymbols));
+
+  size_t i = 0;
+  while (i < n) {
+    int bestLen = 0;
+    int bestDist = 0;
+    if (i + kMinMatch <= n) {
+      const uint32_t h = hash4(data + i);
+      const int32_t candidate = head[h];
+      head[h] = static_cast<int32_t>(i);
+      if (candidate >= 0 && i - static_cast<size_t>(candidate) <= kWindowSize) {
+        const size_t maxLen = std::min<size_t>(kMaxMatch, n - i);
+        size_t len = 0;
+        while (len < maxLen && data[candidate + len] == data[i + len])
+          ++len;
+        if (len >= static_cast<size_t>(kMinMatch)) {
+          bestLen = static_cast<int>(len);
+          bestDist = static_cast<int>(i - static_cast<size_t>(candidate));
+        }
+      }
+    }
+
+    if (bestLen > 0) {
+      symbols.push_back({static_cast<uint16_t>(bestLen), static_cast<uint16_t>(bestDist)});
+      // index a few positions inside the match so later data can refer to it
+      const size_t end = i + static_cast<size_t>(bestLen);
+      for (size_t k = i + 1; k < end && k + kMinMatch <= n && k < i + 4; ++k)
+        head[hash4(data + k)] = static_cast<int32_t>(k);
+      i = end;
+    } else {
+      symbols.push_back({data[i], 0});
+      ++i;
+    }
+
+    // a full block at the end of the input is left to the final write below, which also
+    // has to set BFINAL: writing it here as well would end the stream twice
+    if (symbols.size() >= kMaxBlockSymbols && i < n) {
+      writeDynamicBlock(symbols, false, bw);
+      symbols.clear();
+    }
+  }
+
+  if (!symbols.empty() || last || n == 0)
+    writeDynamicBlock(symbols, last, bw);
+
+  if (!last) {
+    // sync flush: empty stored block to end on a byte boundary
+    bw.put(0, 3);
+    bw.align();
+    bw.put(0x0000, 16);
+    bw.put(0xffff, 16);
+  } else {
+    bw.align();
+  }
+}
+
+bool inflateZlib(const uint8_t *data, size_t n, std::vector<uint8_t> &out, size_t maxSize, std::string &outError) {
+  if (n < 6 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) {
+    outError = "Invalid zlib header.";
+    return false;
+  }
+  // deflate expands at most ~1032:1, a stream cannot claim more memory than that up front
+  out.reserve(out.size() + std::min(maxSize, n * kMaxExpansion));
+  const size_t start = out.size();
+  const size_t limit = start + maxSize;
+
+  BitReader br(data + 2, n - 2);
+  bool final = false;
+  while (!final) {
+    final = br.get(1) != 0;
+    const uint32_t type = br.get(2);
+    if (type == 0) {
+      br.align();
+      const size_t pos = br.bytePosition();
+      if (pos + 4 > n - 2) {
+        outError = "Truncated stored block.";
+        return false;
+      }
+      const uint8_t *p = data + 2 + pos;
+      const size_t len = p[0] | (p[1] << 8);
+      const size_t nlen = p[2] | (p[3] << 8);
+      if ((len ^ 0xffff) != nlen || pos + 4 + len > n - 2) {
+        outError = "Corrupt stored block.";
+        return false;
+      }
+      if (len > limit - out.size()) {
+        outError = "Decompressed data exceeds the expected size.";
+        return false;
+      }
+      out.insert(out.end(), p + 4, p + 4 + len);
+      br.seek(pos + 4 + len);
+    } else if (type == 1) {
+      if (!inflateBlock(br, fixedTrees().lit, fixedTrees().dist, out, limit, outError))
+        return false;
+    } else if (type == 2) {
+      HuffmanDecoder lit, dist;
+      if (!readDynamicTrees(br, lit, dist, outError) || !inflateBlock(br, lit, dist, out, limit, outError))
+        return false;
+    } else {
+      outError = "Invalid deflate block type.";
+      return false;
+    }
+    if (br.overrun()) {
+      outError = "Truncated deflate stream.";
+      return false;
+    }
+  }
+
+  br.align();
+  const size_t pos = 2 + br.bytePosition();
+  if (pos + 4 > n) {
+    outError = "Missing zlib checksum.";
+    return false;
+  }
+  const uint32_t expected = (uint32_t(data[pos]) << 24) | (uint32_t(data[pos + 1]) << 16) |
+                            (uint32_t(data[pos + 2]) << 8) | data[pos + 3];
+  if (adler32(out.data() + start, out.size() - start) != expected) {
+    outError = "zlib checksum mismatch.";
+    return false;
+  }
+  return true;
+}
+
+} // namespace imageio
@@ -0,0 +1,33 @@
+#ifndef IMAGE_DEFLATE_H
+#define IMAGE_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace imageio {
+
+uint32_t crc32(const uint8_t *data, size_t n, uint32_t crc = 0);
+
+uint32_t adler32(const uint8_t *data, size_t n, uint32_t adler = 1);
+// adler32 of A followed by B, given adler32(A), adler32(B) and the length of B
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t lengthB);
+
+// symbols (literals and matches) per Huffman block written by deflateIndependent
+constexpr size_t kMaxBlockSymbols = 1 << 16;
+
+// Fast deflate (RFC 1951): greedy LZ77 with a single-candidate hash table and dynamic
+// Huffman blocks. Every call compresses 'data' independently of previous calls (no shared
+// window) and ends byte aligned: with 'last' the final block is marked BFINAL, otherwise an
+// empty stored block is appended (sync flush). Independent pieces can therefore be
+// compressed in parallel and simply concatenated into one stream.
+void deflateIndependent(const uint8_t *data, size_t n, bool last, std::vector<uint8_t> &out);
+
+// Decompresses a zlib stream (RFC 1950) and appends the result to 'out'. Returns false and
+// sets outError on malformed input or when the result would exceed 'maxSize' bytes.
+bool inflateZlib(const uint8_t *data, size_t n, std::vector<uint8_t> &out, size_t maxSize, std::string &outError);
+
+} // namespace imageio
+
+#endif
@@ -0,0 +1,543 @@
+#include "image/image_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <vector>
+
+#include "image/deflate.h"
+#include "util/task_scheduler.h"
+
+namespace imageio {
+
+namespace {
+
+// PNG sizes readPng accepts, a corrupt header must not make it allocate gigabytes
+constexpr int kMaxPngSize = 1 << 16;              // per side, as for snapshot textures
+constexpr size_t kMaxPngPixels = size_t(1) << 28; // 1 GB as RGBA
+
+void convertRow(const Framebuffer &fb, int y, unsigned char *out) {
+  for (int x = 0; x < fb.width(); ++x) {
+    const Color &c = fb.at(x, y);
+    out[x * 3 + 0] = toByte(c.x);
+    out[x * 3 + 1] = toByte(c.y);
+    out[x * 3 + 2] = toByte(c.z);
+  }
+}
+
+void putBE32(std::vector<uint8_t> &out, uint32_t v) {
+  out.push_back(static_cast<uint8_t>(v >> 24));
+  out.push_back(static_cast<uint8_t>(v >> 16));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+// Each writer gets its own temp name, a snapshot of the same target may be written while the
+// final streaming writer is still open
+std::string tempName(const std::string &target) {
+  static std::atomic<unsigned> counter{0};
+  return target + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+}
+
+// Temp file handling shared by all formats
+class FileWriter : public ImageWriter {
+public:
+  FileWriter(std::string target, int width, int height)
+      : target_(std::move(target)), tmp_(tempName(target_)), width_(width), height_(height) {}
+
+  ~FileWriter() override {
+    if (file_) {
+      std::fclose(file_);
+      std::remove(tmp_.c_str());
+    }
+  }
+
+  bool open(std::string &outError) {
+    file_ = std::fopen(tmp_.c_str(), "wb");
+    if (!file_)
+      outError = "Could not open " + tmp_ + " for writing.";
+    return file_ != nullptr;
+  }
+
+protected:
+  bool write(const void *data, size_t n, std::string &outError) {
+    if (std::fwrite(data, 1, n, file_) == n)
+      return true;
+    outError = "Write to " + tmp_ + " failed.";
+    return false;
+  }
+
+  bool checkRows(int y0, int y1, std::string &outError) {
+    if (y0 != nextRow_ || y1 < y0 || y1 > height_) {
+      outError = "Rows written out of order.";
+      return false;
+    }
+    nextRow_ = y1;
+    return true;
+  }
+
+  bool close(std::string &outError) {
+    if (nextRow_ != height_) {
+      outError = "Image incomplete, " + std::to_string(height_ - nextRow_) + " rows missing.";
+      return false;
+    }
+    const bool ok = std::fclose(file_) == 0;
+    file_ = nullptr;
+    if (!ok) {
+      outError = "Write to " + tmp_ + " failed.";
+      return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_, target_, ec);
+    if (ec) {
+      outError = "Could not replace " + target_ + ": " + ec.message();
+      return false;
+    }
+    return true;
+  }
+
+  std::string target_;
+  std::string tmp_;
+  std::FILE *file_ = nullptr;
+  int width_;
+  int height_;
+  int nextRow_ = 0;
+};
+
+// binary PPM (P6), one converted row at a time
+class PpmWriter : public FileWriter {
+public:
+  using FileWriter::FileWriter;
+
+  bool writeHeader(std::string &outError) {
+    char header[64];
+    const int n = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width_, height_);
+    row_.resize(static_cast<size_t>(width_) * 3);
+    return write(header, static_cast<size_t>(n), outError);
+  }
+
+  bool writeRows(const Framebuffer &fb, int y0, int y1, std::string &outError) override {
+    if (!checkRows(y0, y1, outError))
+      return false;
+    for (int y = y0; y < y1; ++y) {
+      convertRow(fb, y, row_.data());
+      if (!write(row_.data(), row_.size(), outError))
+        return false;
+    }
+    return true;
+  }
+
+  bool finish(std::string &outError) override {
+    return close(outError);
+  }
+
+private:
+  std::vector<unsigned char> row_;
+};
+
+// Portable float map: linear RGB floats without quantization for compositing. The rows of a
+// Framebuffer already have the PFM pixel layout, each one is dumped as is; PFM stores the
+// bottom row first, so rows are placed at their final offset as they arrive.
+class PfmWriter : public FileWriter {
+public:
+  static_assert(sizeof(Color) == 3 * sizeof(float), "Color must be three packed floats");
+
+  using FileWriter::FileWriter;
+
+  bool writeHeader(std::string &outError) {
+    // a negative scale marks little endian data
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    char header[64];
+    const int n = std::snprintf(header, sizeof(header), "PF\n%d %d\n%s\n", width_, height_,
+                                first == 1 ? "-1.0" : "1.0");
+    headerSize_ = static_cast<long>(n);
+    return write(header, static_cast<size_t>(n), outError);
+  }
+
+  bool writeRows(const Framebuffer &fb, int y0, int y1, std::string &outError) override {
+    if (!checkRows(y0, y1, outError))
+      return false;
+    const size_t rowBytes = static_cast<size_t>(width_) * sizeof(Color);
+    for (int y = y0; y < y1; ++y) {
+      const long offset = headerSize_ + static_cast<long>(height_ - 1 - y) * static_cast<long>(rowBytes);
+      if (std::fseek(file_, offset, SEEK_SET) != 0) {
+        outError = "Seek in " + tmp_ + " failed.";
+        return false;
+      }
+      if (!write(&fb.at(0, y), rowBytes, outError))
+        return false;
+    }
+    return true;
+  }
+
+  bool finish(std::string &outError) override {
+    return close(outError);
+  }
+
+private:
+  long headerSize_ = 0;
+};
+
+// 8 bit RGB PNG. Rows are grouped into bands that are filtered and deflated independently
+// on the TaskScheduler; render workers pick them up between tiles, so compression overlaps
+// with rendering. Every band becomes one IDAT chunk, written
+// in order as soon as it and all bands before it are done. The zlib checksum of the whole
+// stream is combined from the per band checksums.
+class PngWriter : public FileWriter {
+public:
+  PngWriter(std::string target, int width, int height)
+      : FileWriter(std::move(target), width, height), rowBytes_(static_cast<size_t>(width) * 3) {
+    // bands of ~256 KiB raw data keep the compression ratio close to a single stream
+    bandRows_ = static_cast<int>(std::clamp<size_t>((size_t(256) << 10) / std::max<size_t>(1, rowBytes_), 8, 256));
+  }
+
+  bool writeHeader(std::string &outError) {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (!write(kSignature, sizeof(kSignature), outError))
+      return false;
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, static_cast<uint32_t>(width_));
+    putBE32(ihdr, static_cast<uint32_t>(height_));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8 bit, truecolor, deflate, adaptive filter, no interlace
+    return writeChunk("IHDR", ihdr, outError);
+  }
+
+  bool writeRows(const Framebuffer &fb, int y0, int y1, std::string &outError) override {
+    if (!checkRows(y0, y1, outError))
+      return false;
+    while (nextRow_ - bandStart_ >= bandRows_ || (nextRow_ == height_ && bandStart_ < height_)) {
+      const int end = std::min(height_, bandStart_ + bandRows_);
+      bands_.push_back(std::make_unique<Band>());
+      Band *band = bands_.back().get();
+      band->y0 = bandStart_;
+      band->y1 = end;
+      group_.run([this, &fb, band] { compressBand(fb, *band); });
+      bandStart_ = end;
+    }
+    return writeDoneBands(outError);
+  }
+
+  bool finish(std::string &outError) override {
+    group_.wait();
+    if (!writeDoneBands(outError))
+      return false;
+    if (!writeChunk("IEND", {}, outError))
+      return false;
+    return close(outError);
+  }
+
+private:
+  struct Band {
+    int y0 = 0;
+    int y1 = 0;
+    size_t rawSize = 0;
+    uint32_t adler = 1;
+    std::vector<uint8_t> data;
+    std::atomic<bool> done{false};
+  };
+
+  bool writeChunk(const char *type, const std::vector<uint8_t> &data, std::string &outError) {
+    std::vector<uint8_t> head;
+    putBE32(head, static_cast<uint32_t>(data.size()));
+    head.insert(head.end(), type, type + 4);
+    uint32_t crc = crc32(head.data() + 4, 4);
+    crc = crc32(data.data(), data.size(), crc);
+    std::vector<uint8_t> tail;
+    putBE32(tail, crc);
+    return write(head.data(), head.size(), outError) && write(data.data(), data.size(), outError) &&
+           write(tail.data(), tail.size(), outError);
+  }
+
+  // writes finished bands from the front, stops at the first band still being compressed
+  bool writeDoneBands(std::string &outError) {
+    while (!bands_.empty() && bands_.front()->done.load(std::memory_order_acquire)) {
+      Band &band = *bands_.front();
+      std::vector<uint8_t> idat;
+      if (band.y0 == 0)
+        idat.insert(idat.end(), {0x78, 0x01}); // zlib header: deflate, 32K window, fastest
+      idat.insert(idat.end(), band.data.begin(), band.data.end());
+      adler_ = band.y0 == 0 ? band.adler : adler32Combine(adler_, band.adler, band.rawSize);
+      if (band.y1 == height_)
+        putBE32(idat, adler_);
+      if (!writeChunk("IDAT", idat, outError))
+        return false;
+      bands_.pop_front();
+    }
+    return true;
+  }
+
+  // converts, filters and deflates rows [y0, y1); the row above the band is converted again
+  // for the Up/Paeth filters so bands need nothing from each other
+  void compressBand(const Framebuffer &fb, Band &band) const {
+    std::vector<uint8_t> prev(rowBytes_, 0), cur(rowBytes_);
+    if (band.y0 > 0)
+      convertRow(fb, band.y0 - 1, prev.data());
+
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes_ + 1) * static_cast<size_t>(band.y1 - band.y0));
+    std::vector<uint8_t> candidates[4];
+    for (auto &c : candidates)
+      c.resize(rowBytes_);
+
+    for (int y = band.y0; y < band.y1; ++y) {
+      convertRow(fb, y, cur.data());
+      const int filter = filterRow(prev.data(), cur.data(), candidates);
+      raw.push_back(static_cast<uint8_t>(filter + 1));
+      raw.insert(raw.end(), candidates[filter].begin(), candidates[filter].end());
+      std::swap(prev, cur);
+    }
+
+    band.rawSize = raw.size();
+    band.adler = adler32(raw.data(), raw.size());
+    deflateIndependent(raw.data(), raw.size(), band.y1 == height_, band.data);
+    band.done.store(true, std::memory_order_release);
+  }
+
+  // fills Sub, Up, Average and Paeth filtered rows and returns the one with the smallest sum
+  // of absolute residuals (the usual heuristic; None rarely wins on rendered images)
+  int filterRow(const uint8_t *prev, const uint8_t *cur, std::vector<uint8_t> *out) const {
+    long sums[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < rowBytes_; ++i) {
+      const int a = i >= 3 ? cur[i - 3] : 0;
+      const int b = prev[i];
+      const int c = i >= 3 ? prev[i - 3] : 0;
+      const int p = a + b - c;
+      const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+      const int paeth = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+      const uint8_t v[4] = {static_cast<uint8_t>(cur[i] - a), static_cast<uint8_t>(cur[i] - b),
+                            static_cast<uint8_t>(cur[i] - ((a + b) >> 1)), static_cast<uint8_t>(cur[i] - paeth)};
+      for (int f = 0; f < 4; ++f) {
+        out[f][i] = v[f];
+        sums[f] += std::abs(static_cast<int8_t>(v[f]));
+      }
+    }
+    return static_cast<int>(std::min_element(sums, sums + 4) - sums);
+  }
+
+  size_t rowBytes_;
+  int bandRows_;
+  int bandStart_ = 0;
+  uint32_t adler_ = 1;
+  std::deque<std::unique_ptr<Band>> bands_;
+  // declared last: destroyed first, waits for running band tasks
+  TaskGroup group_;
+};
+
+uint32_t getBE32(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+// reverses the PNG row filters in place, 'bpp' bytes per pixel
+bool unfilter(std::vector<uint8_t> &raw, int width, int height, int bpp, std::vector<uint8_t> &pixels,
+              std::string &outError) {
+  const size_t rowBytes = static_cast<size_t>(width) * bpp;
+  pixels.resize(rowBytes * height);
+  const std::vector<uint8_t> zero(rowBytes, 0);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *in = raw.data() + y * (rowBytes + 1);
+    const uint8_t filter = in[0];
+    ++in;
+    uint8_t *cur = pixels.data() + y * rowBytes;
+    const uint8_t *prev = y > 0 ? cur - rowBytes : zero.data();
+    switch (filter) {
+    case 0:
+      std::copy(in, in + rowBytes, cur);
+      break;
+    case 1:
+      for (size_t i = 0; i < rowBytes; ++i)
+        cur[i] = static_cast<uint8_t>(in[i] + (i >= static_cast<size_t>(bpp) ? cur[i - bpp] : 0));
+      break;
+    case 2:
+      for (size_t i = 0; i < rowBytes; ++i)
+        cur[i] = static_cast<uint8_t>(in[i] + prev[i]);
+      break;
+    case 3:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        const int a = i >= static_cast<size_t>(bpp) ? cur[i - bpp] : 0;
+        cur[i] = static_cast<uint8_t>(in[i] + ((a + prev[i]) >> 1));
+      }
+      break;
+    case 4:
+      for (size_t i = 0; i < rowBytes; ++i) {
+        const int a = i >= static_cast<size_t>(bpp) ? cur[i - bpp] : 0;
+        const int b = prev[i];
+        const int c = i >= static_cast<size_t>(bpp) ? prev[i - bpp] : 0;
+        const int p = a + b - c;
+        const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        cur[i] = static_cast<uint8_t>(in[i] + ((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c)));
+      }
+      break;
+    default:
+      outError = "Invalid PNG filter type " + std::to_string(filter) + ".";
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+bool readPng(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgba, std::string &outError) {
+  std::FILE *f = std::fopen(path.c_str(), "rb");
+  if (!f) {
+    outError = "Could not open " + path + ".";
+    return false;
+  }
+  std::vector<uint8_t> file;
+  uint8_t buffer[1 << 16];
+  for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;)
+    file.insert(file.end(), buffer, buffer + n);
+  std::fclose(f);
+
+  static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  if (file.size() < 8 || !std::equal(kSignature, kSignature + 8, file.begin())) {
+    outError = path + " is not a PNG file.";
+    return false;
+  }
+
+  int colorType = -1;
+  std::vector<uint8_t> idat, palette, paletteAlpha;
+  for (size_t pos = 8; pos + 12 <= file.size();) {
+    const uint32_t length = getBE32(&file[pos]);
+    const std::string type(reinterpret_cast<const char *>(&file[pos + 4]), 4);
+    if (pos + 12 + length > file.size()) {
+      outError = path + ": truncated " + type + " chunk.";
+      return false;
+    }
+    const uint8_t *data = &file[pos + 8];
+    if (type == "IHDR" && length >= 13) {
+      width = static_cast<int>(getBE32(data));
+      height = static_cast<int>(getBE32(data + 4));
+      colorType = data[9];
+      if (data[8] != 8 || data[12] != 0) {
+        outError = path + ": only 8 bit non-interlaced PNGs are supported.";
+        return false;
+      }
+    } else if (type == "PLTE") {
+      palette.assign(data, data + length);
+    } else if (type == "tRNS") {
+      paletteAlpha.assign(data, data + length);
+    } else if (type == "IDAT") {
+      idat.insert(idat.end(), data, data + length);
+    } else if (type == "IEND") {
+      break;
+    }
+    pos += 12 + length;
+  }
+
+  int bpp = 0;
+  switch (colorType) {
+  case 0: bpp = 1; break;
+  case 2: bpp = 3; break;
+  case 3: bpp = 1; break;
+  case 4: bpp = 2; break;
+  case 6: bpp = 4; break;
+  default:
+    outError = path + ": missing IHDR or unsupported color type.";
+    return false;
+  }
+  if (width <= 0 || height <= 0) {
+    outError = path + ": invalid image size.";
+    return false;
+  }
+  if (width > kMaxPngSize || height > kMaxPngSize || static_cast<size_t>(width) * height > kMaxPngPixels) {
+    outError = path + ": image size " + std::to_string(width) + "x" + std::to_string(height) + " exceeds the supported maximum.";
+    return false;
+  }
+
+  const size_t rawSize = (static_cast<size_t>(width) * bpp + 1) * height;
+  std::vector<uint8_t> raw, pixels;
+  if (!inflateZlib(idat.data(), idat.size(), raw, rawSize, outError)) {
+    outError = path + ": " + outError;
+    return false;
+  }
+  if (raw.size() < rawSize) {
+    outError = path + ": image data too short.";
+    return false;
+  }
+  if (!unfilter(raw, width, height, bpp, pixels, outError)) {
+    outError = path + ": " + outError;
+    return false;
+  }
+  raw = std::vector<uint8_t>(); // release before expanding to RGBA
+
+  const size_t count = static_cast<size_t>(width) * height;
+  rgba.resize(count * 4);
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t *out = &rgba[i * 4];
+    const uint8_t *in = &pixels[i * bpp];
+    switch (colorType) {
+    case 0:
+      out[0] = out[1] = out[2] = in[0];
+      out[3] = 255;
+      break;
+    case 2:
+      out[0] = in[0];
+      out[1] = in[1];
+      out[2] = in[2];
+      out[3] = 255;
+      break;
+    case 3: {
+      const size_t index = in[0];
+      if (index * 3 + 2 >= palette.size()) {
+        outError = path + ": palette index out of range.";
+        return false;
+      }
+      out[0] = palette[index * 3];
+      out[1] = palette[index * 3 + 1];
+      out[2] = palette[index * 3 + 2];
+      out[3] = index < paletteAlpha.size() ? paletteAlpha[index] : 255;
+      break;
+    }
+    case 4:
+      out[0] = out[1] = out[2] = in[0];
+      out[3] = in[1];
+      break;
+    default:
+      out[0] = in[0];
+      out[1] = in[1];
+      out[2] = in[2];
+      out[3] = in[3];
+      break;
+    }
+  }
+  return true;
+}
+
+std::unique_ptr<ImageWriter> openImage(const std::string &path, int width, int height, std::string &outPath,
+                                       std::string &outError) {
+  std::filesystem::path target(path);
+  if (target.extension() != ".ppm" && target.extension() != ".png" && target.extension() != ".pfm")
+    target.replace_extension(".png");
+  outPath = target.string();
+
+  if (target.extension() == ".pfm") {
+    auto writer = std::make_unique<PfmWriter>(outPath, width, height);
+    if (!writer->open(outError) || !writer->writeHeader(outError))
+      return nullptr;
+    return writer;
+  }
+  if (target.extension() == ".ppm") {
+    auto writer = std::make_unique<PpmWriter>(outPath, width, height);
+    if (!writer->open(outError) || !writer->writeHeader(outError))
+      return nullptr;
+    return writer;
+  }
+  auto writer = std::make_unique<PngWriter>(outPath, width, height);
+  if (!writer->open(outError) || !writer->writeHeader(outError))
+    return nullptr;
+  return writer;
+}
+
+bool writeImage(const std::string &path, const Framebuffer &fb, std::string &outPath, std::string &outError) {
+  std::unique_ptr<ImageWriter> writer = openImage(path, fb.width(), fb.height(), outPath, outError);
+  return writer && writer->writeRows(fb, 0, fb.height(), outError) && writer->finish(outError);
+}
+
+} // namespace imageio
@@ -0,0 +1,51 @@
+#ifndef IMAGE_IMAGE_IO_H
+#define IMAGE_IMAGE_IO_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render/framebuffer.h"
+
+namespace imageio {
+
+// Streams a framebuffer to disk in row order while it is being rendered. Rows are converted
+// to 8 bit as they arrive, so no second full size copy of the image exists. The file is
+// written to a temporary name and moved into place by finish(), viewers never see a
+// partially written image.
+class ImageWriter {
+public:
+  virtual ~ImageWriter() = default;
+
+  // Rows [y0, y1) of fb are final. Rows must arrive in order without gaps, fb must stay
+  // alive and unchanged in these rows until finish(). May be called from any thread, but not concurrently.
+  virtual bool writeRows(const Framebuffer &fb, int y0, int y1, std::string &outError) = 0;
+
+  // Writes outstanding data and replaces the target file, all rows must have been written
+  virtual bool finish(std::string &outError) = 0;
+};
+
+// Opens a writer for a width x height image, the format is chosen by the file extension
+// (.png, .ppm or .pfm for linear float data). Other extensions are written as PNG next to the requested file; the path
+// actually written is returned in outPath. Returns nullptr on error.
+std::unique_ptr<ImageWriter> openImage(const std::string &path, int width, int height, std::string &outPath,
+                                       std::string &outError);
+
+// Writes the whole framebuffer at once, see openImage()
+bool writeImage(const std::string &path, const Framebuffer &fb, std::string &outPath, std::string &outError);
+
+// Decodes an 8 bit, non-interlaced PNG (gray, gray+alpha, RGB, RGBA or palette) into
+// width * height RGBA texels, top row first. Alpha is 255 for formats without alpha. Images
+// above 65536 pixels per side or 2^28 pixels in total are rejected.
+bool readPng(const std::string &path, int &width, int &height, std::vector<uint8_t> &rgba, std::string &outError);
+
+// Linear float to 8 bit, clamped to [0, 1]
+inline unsigned char toByte(float v) {
+  v = v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+  return static_cast<unsigned char>(v * 255.f + 0.5f);
+}
+
+} // namespace imageio
+
+#endif
@@ -1,25 +1,270 @@
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "image/image_io.h"
 #include "parser/scene_parser.h"
+#include "parser/scene_snapshot.h"
+#include "render/framebuffer.h"
+#include "render/render_settings.h"
+#include "render/renderer.h"
+#include "render/wavefront_renderer.h"
+#include "util/snapshot_signal.h"
+#include "util/task_scheduler.h"
+
+namespace {
+
+// Parses "--name=value" options following the scene path
+bool parseOptions(int argc, char **argv, RenderSettings &settings, std::string &outError) {
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string name = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    try {
+      if (name == "--min-throughput") {
+        settings.minThroughput = std::stof(value);
+      } else if (name == "--light-cull") {
+        settings.lightCullPower = std::stof(value);
+        if (settings.lightCullPower < 0.f)
+          throw std::invalid_argument("light cull");
+      } else if (name == "--shadow-map") {
+        settings.shadowMapResolution = std::stoi(value);
+        if (settings.shadowMapResolution < 0)
+          throw std::invalid_argument("shadow map");
+      } else if (name == "--no-occluder-cache") {
+        settings.occluderCache = false;
+      } else if (name == "--fast-pow") {
+        settings.fastPow = true;
+      } else if (name == "--spp") {
+        settings.samplesPerPixel = std::stoi(value);
+        if (settings.samplesPerPixel <= 0)
+          throw std::invalid_argument("spp");
+      } else if (name == "--adaptive-aa") {
+        settings.adaptiveAA = true;
+      } else if (name == "--aa-threshold") {
+        settings.aaThreshold = std::stof(value);
+      } else if (name == "--aa-max-samples") {
+        settings.aaMaxSamples = std::stoi(value);
+      } else if (name == "--progressive") {
+        settings.progressive = true;
+      } else if (name == "--snapshot-interval") {
+        settings.snapshotInterval = std::stof(value);
+      } else if (name == "--also-png") {
+        settings.alsoPng = true;
+      } else if (name == "--threads") {
+        settings.threads = static_cast<unsigned>(std::stoul(value));
+      } else if (name == "--pin-threads") {
+        settings.pinThreads = true;
+      } else if (name == "--tile-size") {
+        settings.tileSize = std::stoi(value);
+        if (settings.tileSize <= 0)
+          throw std::invalid_argument("tile size");
+      } else if (name == "--adaptive-tiles") {
+        settings.adaptiveTiles = true;
+      } else if (name == "--tile-stats") {
+        settings.tileStats = true;
+      } else if (name == "--save-scene") {
+        if (value.empty())
+          throw std::invalid_argument("save scene");
+        settings.saveScenePath = value;
+      } else if (name == "--texture-layout") {
+        if (value == "rowmajor")
+          settings.textureLayout = TextureLayout::ROW_MAJOR;
+        else if (value == "tiled")
+          settings.textureLayout = TextureLayout::TILED;
+        else if (value == "zorder")
+          settings.textureLayout = TextureLayout::Z_ORDER;
+        else
+          throw std::invalid_argument("texture layout");
+      } else if (name == "--texture-cache-mb") {
+        settings.textureCacheMB = std::stoul(value);
+      } else if (name == "--texture-cache-dir") {
+        if (value.empty())
+          throw std::invalid_argument("texture cache dir");
+        settings.textureCacheDir = value;
+      } else if (name == "--wavefront") {
+        settings.wavefront = true;
+      } else if (name == "--wavefront-batch") {
+        settings.wavefrontBatchSize = static_cast<unsigned>(std::stoul(value));
+      } else if (name == "--sort-rays") {
+        settings.sortRays = true;
+      } else {
+        outError = "Unknown option " + arg;
+        return false;
+      }
+    } catch (const std::exception &) {
+      outError = "Invalid value for option " + arg;
+      return false;
+    }
+  }
+  // the wavefront renderer takes a fixed number of samples per pixel
+  if (settings.wavefront && settings.adaptiveAA) {
+    outError = "--adaptive-aa is not supported with --wavefront";
+    return false;
+  }
+  // progressive passes and snapshots are driven by the tile renderer
+  if (settings.wavefront && settings.progressive) {
+    outError = "--progressive is not supported with --wavefront";
+    return false;
+  }
+  return true;
+}
+
+} // namespace
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: " << argv[0] << " <scene.xml>\n";
+    std::cerr << "Usage: " << argv[0] << " <scene.xml|scene.rtscene> [options]\n"
+              << "  --min-throughput=<f>   cull secondary rays below this weight (default 1e-3)\n"
+              << "  --light-cull=<f>       skip groups of lights dimmer than f in sum (default 0: exact)\n"
+              << "  --shadow-map=<n>       n x n depth map per parallel light to skip most of its shadow rays\n"
+              << "  --no-occluder-cache    do not test the last occluder of a light first\n"
+              << "  --fast-pow             approximate the Phong specular pow (slightly less exact highlights)\n"
+              << "  --spp=<n>              camera rays per pixel (default 1)\n"
+              << "  --adaptive-aa          add samples where neighbour contrast is high (not with --wavefront)\n"
+              << "  --aa-threshold=<f>     contrast/noise threshold for --adaptive-aa (default 0.1)\n"
+              << "  --aa-max-samples=<n>   sample cap per pixel for --adaptive-aa (default 16)\n"
+              << "  --progressive          render --spp samples in passes, snapshots on SIGUSR1 (not with --wavefront)\n"
+              << "  --snapshot-interval=<s> also write a snapshot every s seconds (progressive)\n"
+              << "  --also-png             with a .pfm output file also write an 8 bit PNG next to it\n"
+              << "  --threads=<n>          worker threads incl. main thread (default: all cores)\n"
+              << "  --pin-threads          bind worker threads to CPUs\n"
+              << "  --tile-size=<n>        tile edge length in pixels (default 32)\n"
+              << "  --adaptive-tiles       order/split tiles by cost from a low resolution pre-pass\n"
+              << "  --tile-stats           print per-tile timings\n"
+              << "  --save-scene=<f>       also write the loaded scene to f for fast reloading (.rtscene)\n"
+              << "  --texture-layout=<l>   texel order: rowmajor, tiled (default) or zorder\n"
+              << "  --texture-cache-mb=<n> page texture tiles on demand within n MB (default: load all)\n"
+              << "  --texture-cache-dir=<d> tile files for --texture-cache-mb (default texture_cache)\n"
+              << "  --wavefront            breadth-first rendering over ray batches\n"
+              << "  --wavefront-batch=<n>  pixels per wavefront batch (default 65536)\n"
+              << "  --sort-rays            reorder secondary rays before traversal (wavefront)\n";
     return 1;
   }
 
-  Scene scene;
+  RenderSettings settings;
   std::string error;
+  if (!parseOptions(argc, argv, settings, error)) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+
+  // one pool for loading and rendering, configured before any parallel work starts
+  TaskScheduler::instance().configure(settings.threads, settings.pinThreads);
+
+  Scene scene;
   SceneParser parser;
+  scene.texturesMutable().setLayout(settings.textureLayout);
+  if (settings.textureCacheMB > 0)
+    scene.texturesMutable().setTileCache(settings.textureCacheDir, settings.textureCacheMB << 20);
 
-  if (!parser.loadSceneFromXMLFile(argv[1], scene, error)) {
+  const auto loadStart = std::chrono::steady_clock::now();
+  const bool fromSnapshot = std::filesystem::path(argv[1]).extension() == ".rtscene";
+  if (fromSnapshot ? !loadSceneSnapshot(argv[1], scene, error) : !parser.loadSceneFromXMLFile(argv[1], scene, error)) {
     std::cerr << "Parse error: " << error << "\n";
     return 2;
   }
+  const auto loadMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - loadStart).count();
+  if (!settings.saveScenePath.empty() && !saveSceneSnapshot(scene, settings.saveScenePath, error)) {
+    std::cerr << "Scene save failed: " << error << "\n";
+    return 3;
+  }
 
   std::cout << scene << "\n";
-  std::cout << "Parsed OK!\n";
+  std::cout << "Parsed OK! (" << loadMs << " ms)\n";
+
+  const Camera &camera = scene.camera();
+  Framebuffer fb(camera.resHorizontal(), camera.resVertical());
+  RenderStats stats;
+
+  // opened before rendering so an unwritable path fails early; the depth-first renderer
+  // streams finished rows to the images while it renders
+  struct Output {
+    std::unique_ptr<imageio::ImageWriter> writer;
+    std::string path;
+  };
+  std::vector<Output> outputs;
+  auto openOutput = [&](const std::string &path) {
+    Output out;
+    out.writer = imageio::openImage(path, fb.width(), fb.height(), out.path, error);
+    if (!out.writer)
+      return false;
+    outputs.push_back(std::move(out));
+    return true;
+  };
+  if (!openOutput(scene.outputFileName()) ||
+      (settings.alsoPng && std::filesystem::path(outputs[0].path).extension() == ".pfm" &&
+       !openOutput(std::filesystem::path(outputs[0].path).replace_extension(".png").string()))) {
+    std::cerr << "Image output failed: " << error << "\n";
+    return 3;
+  }
+  std::string streamError;
+  auto writeRows = [&](int y0, int y1) {
+    for (Output &out : outputs)
+      if (streamError.empty())
+        out.writer->writeRows(fb, y0, y1, streamError);
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  if (settings.wavefront) {
+    WavefrontRenderer renderer(scene, settings);
+    renderer.render(fb);
+    stats = renderer.stats();
+    writeRows(0, fb.height());
+  } else if (settings.progressive) {
+    installSnapshotSignalHandler();
+    auto lastSnapshot = std::chrono::steady_clock::now();
+
+    Renderer renderer(scene, settings);
+    renderer.renderProgressive(fb, [&](const Framebuffer &current, int samples) {
+      const auto now = std::chrono::steady_clock::now();
+      const bool due = settings.snapshotInterval > 0.f &&
+                       std::chrono::duration<float>(now - lastSnapshot).count() >= settings.snapshotInterval;
+      if (!consumeSnapshotRequest() && !due)
+        return;
+      lastSnapshot = now;
+
+      std::string written, writeError;
+      if (imageio::writeImage(scene.outputFileName(), current, written, writeError))
+        std::cout << "Snapshot at " << samples << " spp written to " << written << "\n";
+      else
+        std::cerr << "Snapshot failed: " << writeError << "\n";
+    });
+    stats = renderer.stats();
+    if (settings.tileStats)
+      printTileReport(std::cout, renderer.tileTimings());
+    writeRows(0, fb.height());
+  } else {
+    Renderer renderer(scene, settings);
+    renderer.render(fb, writeRows);
+    stats = renderer.stats();
+    if (settings.tileStats)
+      printTileReport(std::cout, renderer.tileTimings());
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  std::cout << "Rendered " << fb.width() << "x" << fb.height() << " in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms\n";
+  std::cout << stats << "\n";
+  if (const TextureTileCache *cache = scene.textures().tileCache()) {
+    const TextureTileCache::Stats cs = cache->stats();
+    std::cout << "TextureCache{hits=" << cs.hits << ", misses=" << cs.misses << ", evictions=" << cs.evictions
+              << ", read_errors=" << cs.readErrors << ", peak_mb=" << static_cast<double>(cs.peakBytes) / (1 << 20)
+              << ", budget_mb=" << (cache->budgetBytes() >> 20) << "}\n";
+  }
+
+  for (Output &out : outputs) {
+    if (!streamError.empty() || !out.writer->finish(error)) {
+      std::cerr << "Image output failed: " << (streamError.empty() ? error : streamError) << "\n";
+      return 3;
+    }
+    std::cout << "Image written to " << out.path << "\n";
+  }
 
   return 0;
 }
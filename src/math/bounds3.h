@@ -0,0 +1,80 @@
+#ifndef BOUNDS3_H
+#define BOUNDS3_H
+
+#include <algorithm>
+#include <limits>
+
+#include "math/ray.h"
+#include "math/vec3.h"
+
+// Axis aligned bounding box, empty by default (min > max)
+struct Bounds3 {
+  Vec3 min{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()};
+  Vec3 max{-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+
+  bool empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  void expand(const Vec3 &p) {
+    min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+    max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+  }
+
+  void expand(const Bounds3 &b) {
+    expand(b.min);
+    expand(b.max);
+  }
+
+  Vec3 extent() const {
+    return max - min;
+  }
+
+  Vec3 centroid() const {
+    return (min + max) * 0.5f;
+  }
+
+  float surfaceArea() const {
+    if (empty())
+      return 0.f;
+    const Vec3 e = extent();
+    return 2.f * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+
+  // 0 = x, 1 = y, 2 = z
+  int largestAxis() const {
+    const Vec3 e = extent();
+    if (e.x >= e.y && e.x >= e.z)
+      return 0;
+    return e.y >= e.z ? 1 : 2;
+  }
+};
+
+inline float axisValue(const Vec3 &v, int axis) {
+  return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Slab test against a precomputed inverse direction, returns the entry distance in tEntry
+inline bool intersectBounds(const Bounds3 &b, const Ray &ray, const Vec3 &invDir, float &tEntry) {
+  float t0 = ray.tMin, t1 = ray.tMax;
+
+  float tx0 = (b.min.x - ray.origin.x) * invDir.x, tx1 = (b.max.x - ray.origin.x) * invDir.x;
+  if (tx0 > tx1) std::swap(tx0, tx1);
+  t0 = std::max(t0, tx0);
+  t1 = std::min(t1, tx1);
+
+  float ty0 = (b.min.y - ray.origin.y) * invDir.y, ty1 = (b.max.y - ray.origin.y) * invDir.y;
+  if (ty0 > ty1) std::swap(ty0, ty1);
+  t0 = std::max(t0, ty0);
+  t1 = std::min(t1, ty1);
+
+  float tz0 = (b.min.z - ray.origin.z) * invDir.z, tz1 = (b.max.z - ray.origin.z) * invDir.z;
+  if (tz0 > tz1) std::swap(tz0, tz1);
+  t0 = std::max(t0, tz0);
+  t1 = std::min(t1, tz1);
+
+  tEntry = t0;
+  return t0 <= t1;
+}
+
+#endif
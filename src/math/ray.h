@@ -0,0 +1,20 @@
+#ifndef RAY_H
+#define RAY_H
+
+#include <limits>
+
+#include "math/vec3.h"
+
+struct Ray {
+  Vec3 origin{};
+  Vec3 direction{};
+  // valid parameter interval; closest-hit queries shrink tMax while searching
+  float tMin = 1e-4f;
+  float tMax = std::numeric_limits<float>::infinity();
+
+  Vec3 at(float t) const {
+    return origin + direction * t;
+  }
+};
+
+#endif
@@ -1,9 +1,9 @@
 #include "parser/obj-parser/object_parser.h"
+#include "util/task_scheduler.h"
 
 #include <sstream>
 #include <iostream>
-#include <unordered_map>
-#include <functional>
+#include <cstdint>
 #include <cctype>
 
 namespace {
@@ -70,189 +70,225 @@ static inline bool to_int(const std::string& s, int& out) {
 
 } // namespace
 
-ObjMeshData parseObj(const std::string& text) {
-    // Repos mit Dummy an Index 0 (wie in deinem JS)
-    std::vector<std::vector<float>> vertexPositionRepo = { {0.f, 0.f, 0.f} };
-    std::vector<std::vector<float>> normalVectorRepo   = { {0.f, 0.f, 0.f} };
-    std::vector<std::vector<float>> textureCoordRepo   = { {0.f, 0.f} };
-
-    ObjMeshData out;
+namespace {
 
-    auto parseIndex = [&](const std::string& indexString, int repoLength) -> int {
-        // JS: Number("") -> 0 => meaning "empty"
-        if (indexString.empty()) return 0;
+enum class LineKind : uint8_t { Position, Normal, TexCoord, Face, Unknown };
 
-        int idx = 0;
-        if (!to_int(indexString, idx)) {
-            std::cerr << "The obj index is not an integer: '" << indexString << "'\n";
-            return 0;
+// Eine relevante Zeile: Keyword-Art und der getrimmte Rest nach dem Keyword (bei unbekannten
+// Keywords das Keyword selbst, für die Warnung)
+struct ObjLine {
+    std::string rest;
+    int lineNo = 0;
+    LineKind kind = LineKind::Position;
+};
+
+// Ergebnis von Phase 2 (pro Zeile, unabhängig parsebar)
+struct ParsedLine {
+    bool valid = false;
+    float value[3] = {0.f, 0.f, 0.f};  // v / vn / vt
+    std::string token[3];              // f: die drei Vertex-Tokens "v/vt/vn"
+    int index[3][3] = {};              // f: v, vt, vn Index pro Vertex (0 = leer/ungültig)
+    std::string warnings;              // erst in Phase 3 ausgegeben, damit sie in Dateireihenfolge erscheinen
+};
+
+// Zeilen, die pro Task geparst werden
+constexpr size_t kLinesPerTask = 4096;
+
+bool parseNumbers(const ObjLine& line, ParsedLine& out, const char* what, const char* keyword,
+                  size_t minCount, size_t maxCount, const char* countMessage) {
+    const auto parts = line.rest.empty() ? std::vector<std::string>{} : split_ws(line.rest);
+    std::vector<float> nums;
+    nums.reserve(parts.size());
+    for (const auto& p : parts) {
+        float f = 0.f;
+        if (!to_float(p, f)) {
+            out.warnings += std::string("Invalid float in ") + what + ": " + keyword + " " + p + "\n";
+            return false;
         }
+        nums.push_back(f);
+    }
+    if (nums.size() < minCount || nums.size() > maxCount) {
+        out.warnings += std::string(countMessage) + keyword + " (count=" + std::to_string(nums.size()) + ")\n";
+    }
+    for (size_t i = 0; i < nums.size() && i < 3; ++i) out.value[i] = nums[i];
+    return true;
+}
 
-        if (idx == 0) {
-            return 0; // empty (0 is not existing)
+// Phase 2: eine Zeile ohne Kontext parsen (Indizes werden erst in Phase 3 geprüft)
+void parseLine(const ObjLine& line, ParsedLine& out) {
+    switch (line.kind) {
+    case LineKind::Position:
+        out.valid = parseNumbers(line, out, "vertex position", "v", 2, 3, "In the obj file is a invalid vertex position: ");
+        break;
+    case LineKind::Normal:
+        out.valid = parseNumbers(line, out, "normal vector", "vn", 2, 3, "In the obj file has invalid normal vectors: ");
+        break;
+    case LineKind::TexCoord:
+        out.valid = parseNumbers(line, out, "texture coord", "vt", 2, 2, "The obj file is having invalid texture coordinates: ");
+        break;
+    case LineKind::Face: {
+        const auto parts = line.rest.empty() ? std::vector<std::string>{} : split_ws(line.rest);
+        if (parts.size() != 3) {
+            out.warnings += "The obj file is having a face unable to be mapped to a triangle containing " +
+                            std::to_string(parts.size()) + " vertecis\n";
+            return;
         }
-
-        if (idx > 0) {
-            if (idx >= repoLength) {
-                std::cerr << "The obj index is out of range: " << idx
-                          << " with " << repoLength << " element in found\n";
-                return 0;
+        for (int v = 0; v < 3; ++v) {
+            // "2//1" -> ["2", "", "1"]
+            const auto comps = split_char(parts[v], '/');
+            for (int c = 0; c < 3; ++c) {
+                const std::string indexString = comps.size() > static_cast<size_t>(c) ? comps[c] : "";
+                // JS: Number("") -> 0 => meaning "empty"
+                int idx = 0;
+                if (!indexString.empty() && !to_int(indexString, idx)) {
+                    out.warnings += "The obj index is not an integer: '" + indexString + "'\n";
+                    idx = 0;
+                }
+                out.index[v][c] = idx;
             }
-            return idx;
-        } else {
-            // Dein JS: negative => invalid
-            std::cerr << "The obj index: " << idx << " is an unvalid index\n";
-            return 0;
-        }
-    };
-
-    auto addVertex = [&](const std::string& token) {
-        // "2//1" -> ["2", "", "1"]
-        const auto comps = split_char(token, '/');
-
-        const std::string vString  = comps.size() > 0 ? comps[0] : "";
-        const std::string vtString = comps.size() > 1 ? comps[1] : "";
-        const std::string vnString = comps.size() > 2 ? comps[2] : "";
-
-        const int vIndex  = parseIndex(vString,  static_cast<int>(vertexPositionRepo.size()));
-        const int vtIndex = parseIndex(vtString, static_cast<int>(textureCoordRepo.size()));
-        const int vnIndex = parseIndex(vnString, static_cast<int>(normalVectorRepo.size()));
-
-        if (vIndex == 0) {
-            std::cerr << "Face: (f " << token << ") is using a undefined vertex position (v)!\n";
-            return;
+            out.token[v] = parts[v];
         }
+        out.valid = true;
+        break;
+    }
+    case LineKind::Unknown:
+        break;
+    }
+}
 
-        // Position (immer 3 floats pushen; falls nur 2D -> z=0)
-        const auto& v = vertexPositionRepo[vIndex];
-        out.position.push_back(v.size() > 0 ? v[0] : 0.f);
-        out.position.push_back(v.size() > 1 ? v[1] : 0.f);
-        out.position.push_back(v.size() > 2 ? v[2] : 0.f);
-
-        // Texcoord (oder placeholder 0,0)
-        if (vtIndex != 0) {
-            const auto& vt = textureCoordRepo[vtIndex];
-            out.texcoord.push_back(vt.size() > 0 ? vt[0] : 0.f);
-            out.texcoord.push_back(vt.size() > 1 ? vt[1] : 0.f);
-        } else {
-            out.texcoord.push_back(0.f);
-            out.texcoord.push_back(0.f);
+// Range check wie im JS: 0 = leer, negative und zu große Indizes sind ungültig
+int checkIndex(int idx, int repoLength) {
+    if (idx == 0) {
+        return 0; // empty (0 is not existing)
+    }
+    if (idx > 0) {
+        if (idx >= repoLength) {
+            std::cerr << "The obj index is out of range: " << idx
+                      << " with " << repoLength << " element in found\n";
+            return 0;
         }
+        return idx;
+    }
+    // Dein JS: negative => invalid
+    std::cerr << "The obj index: " << idx << " is an unvalid index\n";
+    return 0;
+}
 
-        // Normal (oder placeholder 0,0,0)
-        if (vnIndex != 0) {
-            const auto& vn = normalVectorRepo[vnIndex];
-            out.normal.push_back(vn.size() > 0 ? vn[0] : 0.f);
-            out.normal.push_back(vn.size() > 1 ? vn[1] : 0.f);
-            out.normal.push_back(vn.size() > 2 ? vn[2] : 0.f);
-        } else {
-            out.normal.push_back(0.f);
-            out.normal.push_back(0.f);
-            out.normal.push_back(0.f);
-        }
-    };
+} // namespace
 
-    auto handleVertexPosition = [&](const std::vector<std::string>& parts) {
-        std::vector<float> nums;
-        nums.reserve(parts.size());
-        for (const auto& p : parts) {
-            float f = 0.f;
-            if (!to_float(p, f)) {
-                std::cerr << "Invalid float in vertex position: v " << p << "\n";
-                return;
+// Parst in drei Phasen, damit der teure Teil (Zahlen parsen) parallel laufen kann:
+//   1. seriell: Zeilen zerlegen und nach Keyword klassifizieren
+//   2. parallel: jede Zeile für sich parsen
+//   3. seriell: Repos in Dateireihenfolge aufbauen und Face-Indizes prüfen (wie bisher,
+//      ein Index darf nur auf vorher definierte Einträge zeigen); alle Warnungen werden
+//      hier in Dateireihenfolge ausgegeben
+//   4. parallel: expandierte Vertex-Arrays schreiben
+ObjMeshData parseObj(const std::string& text) {
+    // Phase 1
+    std::vector<ObjLine> lines;
+    {
+        std::istringstream stream(text);
+        std::string line;
+        int lineNo = 0;
+
+        while (std::getline(stream, line)) {
+            ++lineNo;
+            const std::string lineText = trim(line);
+            if (lineText.empty() || starts_with(lineText, "#")) continue;
+
+            // keyword + rest
+            size_t firstSpace = lineText.find_first_of(" \t\r");
+            std::string keyword, rest;
+            if (firstSpace == std::string::npos) {
+                keyword = lineText;
+                rest = "";
+            } else {
+                keyword = lineText.substr(0, firstSpace);
+                rest = trim(lineText.substr(firstSpace));
             }
-            nums.push_back(f);
-        }
-        if (nums.size() < 2 || nums.size() > 3) {
-            std::cerr << "In the obj file is a invalid vertex position: v (count="
-                      << nums.size() << ")\n";
-        }
-        vertexPositionRepo.push_back(std::move(nums));
-    };
 
-    auto handleNormalVector = [&](const std::vector<std::string>& parts) {
-        std::vector<float> nums;
-        nums.reserve(parts.size());
-        for (const auto& p : parts) {
-            float f = 0.f;
-            if (!to_float(p, f)) {
-                std::cerr << "Invalid float in normal vector: vn " << p << "\n";
-                return;
+            LineKind kind;
+            if (keyword == "v") kind = LineKind::Position;
+            else if (keyword == "vn") kind = LineKind::Normal;
+            else if (keyword == "vt") kind = LineKind::TexCoord;
+            else if (keyword == "f") kind = LineKind::Face;
+            else {
+                // Warnung erst in Phase 3
+                lines.push_back({std::move(keyword), lineNo, LineKind::Unknown});
+                continue;
             }
-            nums.push_back(f);
+            lines.push_back({std::move(rest), lineNo, kind});
         }
-        if (nums.size() < 2 || nums.size() > 3) {
-            std::cerr << "In the obj file has invalid normal vectors: vn (count="
-                      << nums.size() << ")\n";
-        }
-        normalVectorRepo.push_back(std::move(nums));
-    };
+    }
 
-    auto handleTextureCoord = [&](const std::vector<std::string>& parts) {
-        std::vector<float> nums;
-        nums.reserve(parts.size());
-        for (const auto& p : parts) {
-            float f = 0.f;
-            if (!to_float(p, f)) {
-                std::cerr << "Invalid float in texture coord: vt " << p << "\n";
-                return;
+    // Phase 2
+    std::vector<ParsedLine> parsed(lines.size());
+    parallelFor(0, lines.size(), kLinesPerTask, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) parseLine(lines[i], parsed[i]);
+    });
+
+    // Phase 3: Repos mit Dummy an Index 0 (wie in deinem JS)
+    std::vector<float> vertexPositionRepo = {0.f, 0.f, 0.f};
+    std::vector<float> normalVectorRepo   = {0.f, 0.f, 0.f};
+    std::vector<float> textureCoordRepo   = {0.f, 0.f};
+
+    struct ResolvedVertex { int v, vt, vn; };
+    std::vector<ResolvedVertex> vertices;
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        ParsedLine& p = parsed[i];
+        if (lines[i].kind == LineKind::Unknown)
+            std::cerr << "Undefined keyword: " << lines[i].rest << " at line " << lines[i].lineNo << "\n";
+        std::cerr << p.warnings;
+        if (!p.valid) continue;
+
+        switch (lines[i].kind) {
+        case LineKind::Position:
+            vertexPositionRepo.insert(vertexPositionRepo.end(), p.value, p.value + 3);
+            break;
+        case LineKind::Normal:
+            normalVectorRepo.insert(normalVectorRepo.end(), p.value, p.value + 3);
+            break;
+        case LineKind::TexCoord:
+            textureCoordRepo.insert(textureCoordRepo.end(), p.value, p.value + 2);
+            break;
+        case LineKind::Face: {
+            const int vLen  = static_cast<int>(vertexPositionRepo.size() / 3);
+            const int vtLen = static_cast<int>(textureCoordRepo.size() / 2);
+            const int vnLen = static_cast<int>(normalVectorRepo.size() / 3);
+            for (int v = 0; v < 3; ++v) {
+                const int vIndex  = checkIndex(p.index[v][0], vLen);
+                const int vtIndex = checkIndex(p.index[v][1], vtLen);
+                const int vnIndex = checkIndex(p.index[v][2], vnLen);
+                if (vIndex == 0) {
+                    std::cerr << "Face: (f " << p.token[v] << ") is using a undefined vertex position (v)!\n";
+                    continue;
+                }
+                vertices.push_back({vIndex, vtIndex, vnIndex});
             }
-            nums.push_back(f);
+            break;
         }
-        if (nums.size() != 2) {
-            std::cerr << "The obj file is having invalid texture coordinates: vt (count="
-                      << nums.size() << ")\n";
-        }
-        textureCoordRepo.push_back(std::move(nums));
-    };
-
-    auto handleFace = [&](const std::vector<std::string>& parts) {
-        if (parts.size() != 3) {
-            std::cerr << "The obj file is having a face unable to be mapped to a triangle containing "
-                      << parts.size() << " vertecis\n";
-            return;
-        }
-        addVertex(parts[0]);
-        addVertex(parts[1]);
-        addVertex(parts[2]);
-    };
-
-    std::unordered_map<std::string, std::function<void(const std::vector<std::string>&)>> keywords = {
-        {"v",  handleVertexPosition},
-        {"vn", handleNormalVector},
-        {"vt", handleTextureCoord},
-        {"f",  handleFace},
-    };
-
-    std::istringstream stream(text);
-    std::string line;
-    int lineNo = 0;
-
-    while (std::getline(stream, line)) {
-        ++lineNo;
-        const std::string lineText = trim(line);
-        if (lineText.empty() || starts_with(lineText, "#")) continue;
-
-        // keyword + rest
-        size_t firstSpace = lineText.find_first_of(" \t\r");
-        std::string keyword, rest;
-        if (firstSpace == std::string::npos) {
-            keyword = lineText;
-            rest = "";
-        } else {
-            keyword = lineText.substr(0, firstSpace);
-            rest = trim(lineText.substr(firstSpace));
+        case LineKind::Unknown:
+            break;
         }
+    }
 
-        auto it = keywords.find(keyword);
-        if (it == keywords.end()) {
-            std::cerr << "Undefined keyword: " << keyword << " at line " << lineNo << "\n";
-            continue;
+    // Phase 4: Position, Texcoord (oder placeholder 0,0), Normal (oder placeholder 0,0,0)
+    ObjMeshData out;
+    out.position.resize(vertices.size() * 3);
+    out.texcoord.resize(vertices.size() * 2);
+    out.normal.resize(vertices.size() * 3);
+    parallelFor(0, vertices.size(), kLinesPerTask, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const ResolvedVertex& rv = vertices[i];
+            for (int c = 0; c < 3; ++c) {
+                out.position[i * 3 + c] = vertexPositionRepo[rv.v * 3 + c];
+                out.normal[i * 3 + c]   = normalVectorRepo[rv.vn * 3 + c];
+            }
+            out.texcoord[i * 2 + 0] = textureCoordRepo[rv.vt * 2 + 0];
+            out.texcoord[i * 2 + 1] = textureCoordRepo[rv.vt * 2 + 1];
         }
-
-        const auto parts = rest.empty() ? std::vector<std::string>{} : split_ws(rest);
-        it->second(parts);
-    }
+    });
 
     return out;
 }
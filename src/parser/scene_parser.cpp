@@ -1,44 +1,127 @@
 #include "parser/scene_parser.h"
 #include "parser/xml_parser_utils.h"
+#include "parser/xml_pull_reader.h"
 #include "scene/lights/utils/lights.h"
 #include "scene/scene.h"
+#include "util/mapped_file.h"
 
 #include <cstring>
 #include <memory>
 #include <sstream>
 
-// Top-level entry: load XML file, locate <scene>, then delegate to parse steps.
+// Top-level entry: the file is mapped and walked with a pull reader instead of being loaded
+// as one DOM. Every light and surface element is parsed on its own into a small reused
+// document and added to the scene right away, so memory stays flat for generated scenes
+// with huge numbers of elements. The scene attributes, background and camera are collected
+// into one small document and validated first, before any mesh is loaded.
 bool SceneParser::loadSceneFromXMLFile(const std::string &path, Scene &outScene, std::string &outError) const {
-  // Load XML document from disk
-  tinyxml2::XMLDocument doc;
-  tinyxml2::XMLError err = doc.LoadFile(path.c_str());
-  if (err != tinyxml2::XML_SUCCESS) {
-    std::ostringstream oss;
-    oss << "XML load failed: " << doc.ErrorStr();
-    outError = oss.str();
+  MappedFile file;
+  if (!file.open(path, outError)) {
+    outError = "XML load failed: " + outError;
     return false;
   }
+  const char *text = reinterpret_cast<const char *>(file.data());
+  XmlPullReader reader(text, text + file.size());
 
   // Find <scene> root element
-  const tinyxml2::XMLElement *xmlElement = doc.FirstChildElement("scene");
-  if (!xmlElement) {
+  XmlPullReader::Element sceneEl;
+  bool found = false;
+  while (!found && reader.nextChild(sceneEl)) {
+    found = sceneEl.name == "scene";
+    if (!found)
+      reader.skip(sceneEl);
+  }
+  if (reader.failed()) {
+    outError = "XML load failed: " + reader.error();
+    return false;
+  }
+  if (!found) {
     outError = "Missing <scene> root element.";
     return false;
   }
 
-  // Parse scene sections
-  if (!parseBasics(xmlElement, outScene, outError))
-    return false;
-  if (!parseCamera(xmlElement, outScene.cameraMutable(), outError))
-    return false;
-  if (!parseLights(xmlElement, outScene, outError))
+  // Parse scene attributes and camera from a first pass over the other children of <scene>.
+  // It skips the lights and surfaces sections and stops once background and camera are found,
+  // usually before the first section.
+  tinyxml2::XMLDocument doc;
+  {
+    XmlPullReader basicsReader = reader;
+    std::string basics(sceneEl.begin, sceneEl.startTagEnd);
+    bool background = false, camera = false;
+    basicsReader.enter(sceneEl);
+    XmlPullReader::Element child;
+    while (!(background && camera) && basicsReader.nextChild(child)) {
+      const char *end = basicsReader.skip(child);
+      if (child.name == "lights" || child.name == "surfaces")
+        continue;
+      basics.append(child.begin, end);
+      background = background || child.name == "background_color";
+      camera = camera || child.name == "camera";
+    }
+    if (basicsReader.failed()) {
+      outError = "XML load failed: " + basicsReader.error();
+      return false;
+    }
+    if (!sceneEl.selfClosing)
+      basics += "</scene>";
+    if (!parseFragment(doc, basics.data(), basics.data() + basics.size(), sceneEl.line, outError))
+      return false;
+    if (!parseBasics(doc.RootElement(), outScene, outError))
+      return false;
+    if (!parseCamera(doc.RootElement(), outScene.cameraMutable(), outError))
+      return false;
+  }
+
+  // Parse lights and surfaces as they come, only the first section of each counts
+  bool seenLights = false, seenSurfaces = false;
+  reader.enter(sceneEl);
+  XmlPullReader::Element section;
+  while (reader.nextChild(section)) {
+    const bool lights = !seenLights && section.name == "lights";
+    const bool surfaces = !seenSurfaces && section.name == "surfaces";
+    if (!lights && !surfaces) {
+      reader.skip(section);
+      continue;
+    }
+    seenLights = seenLights || lights;
+    seenSurfaces = seenSurfaces || surfaces;
+
+    reader.enter(section);
+    XmlPullReader::Element item;
+    while (reader.nextChild(item)) {
+      const char *end = reader.skip(item);
+      if (reader.failed())
+        break;
+      if (!parseFragment(doc, item.begin, end, item.line, outError))
+        return false;
+      const tinyxml2::XMLElement *el = doc.RootElement();
+      if (lights ? !parseLight(el, outScene, outError) : !parseSurface(el, outScene, outError))
+        return false;
+    }
+  }
+  if (reader.failed()) {
+    outError = "XML load failed: " + reader.error();
     return false;
-  if (!parseSurfaces(xmlElement, outScene, outError))
+  }
+
+  // Decode the textures of all materials in parallel
+  if (!outScene.texturesMutable().loadPending(outError))
     return false;
 
   return true;
 }
 
+// Parses the text of one element into 'doc', replacing its previous content
+bool SceneParser::parseFragment(tinyxml2::XMLDocument &doc, const char *begin, const char *end, int line, std::string &outError) const {
+  if (doc.Parse(begin, static_cast<size_t>(end - begin)) != tinyxml2::XML_SUCCESS) {
+    std::ostringstream oss;
+    oss << "XML load failed in the element starting at line " << line << ": " << doc.ErrorStr();
+    outError = oss.str();
+    return false;
+  }
+  return true;
+}
+
 // Parse attributes directly on <scene> ... </scene>
 bool SceneParser::parseBasics(const tinyxml2::XMLElement *xmlElement, Scene &outScene, std::string &outError) const {
   // set output file name
@@ -55,9 +138,7 @@ bool SceneParser::parseBasics(const tinyxml2::XMLElement *xmlElement, Scene &out
     return false;
 
   Color background_color{};
-  if (!xmlutils::readFloatAttribute(bgEl, "r", background_color.x) ||
-      !xmlutils::readFloatAttribute(bgEl, "g", background_color.y) ||
-      !xmlutils::readFloatAttribute(bgEl, "b", background_color.z)) {
+  if (!xmlutils::readColorAttributes(bgEl, background_color)) {
     outError = "background_color must have r,g,b float attributes.";
     return false;
   }
@@ -71,22 +152,23 @@ bool SceneParser::parseCamera(const tinyxml2::XMLElement *xmlElement, Camera &ou
   const tinyxml2::XMLElement *camEl = xmlutils::getRequiredChild(xmlElement, "camera", outError, "scene");
   if (!camEl)
     return false;
+  const xmlutils::ChildIndex camChildren(camEl);
 
   Vec3 pos{}, look{}, up{};
   // Read <position x= y= z=>
-  const tinyxml2::XMLElement *posEl = xmlutils::getRequiredChild(camEl, "position", outError, "camera");
+  const tinyxml2::XMLElement *posEl = xmlutils::getRequiredChild(camChildren, "position", outError, "camera");
   if (!posEl || !xmlutils::readVec3Attributes(posEl, pos)) {
     outError = "Missing/invalid <position x= y= z=> inside <camera>.";
     return false;
   }
   // Read <lookat x= y= z=>
-  const tinyxml2::XMLElement *lookEl = xmlutils::getRequiredChild(camEl, "lookat", outError, "camera");
+  const tinyxml2::XMLElement *lookEl = xmlutils::getRequiredChild(camChildren, "lookat", outError, "camera");
   if (!lookEl || !xmlutils::readVec3Attributes(lookEl, look)) {
     outError = "Missing/invalid <lookat x= y= z=> inside <camera>.";
     return false;
   }
   // Read <up x= y= z=>
-  const tinyxml2::XMLElement *upEl = xmlutils::getRequiredChild(camEl, "up", outError, "camera");
+  const tinyxml2::XMLElement *upEl = xmlutils::getRequiredChild(camChildren, "up", outError, "camera");
   if (!upEl || !xmlutils::readVec3Attributes(upEl, up)) {
     outError = "Missing/invalid <up x= y= z=> inside <camera>.";
     return false;
@@ -94,7 +176,7 @@ bool SceneParser::parseCamera(const tinyxml2::XMLElement *xmlElement, Camera &ou
 
   // Read <horizontal_fov angle=>
   float fovHalf = 0.f;
-  const tinyxml2::XMLElement *fovEl = xmlutils::getRequiredChild(camEl, "horizontal_fov", outError, "camera");
+  const tinyxml2::XMLElement *fovEl = xmlutils::getRequiredChild(camChildren, "horizontal_fov", outError, "camera");
   if (!fovEl || !xmlutils::readFloatAttribute(fovEl, "angle", fovHalf)) {
     outError = "Missing/invalid <horizontal_fov angle=> inside <camera>.";
     return false;
@@ -102,7 +184,7 @@ bool SceneParser::parseCamera(const tinyxml2::XMLElement *xmlElement, Camera &ou
 
   // Read <resolution horizontal= vertical=>
   int w = 0, h = 0;
-  const tinyxml2::XMLElement *resEl = xmlutils::getRequiredChild(camEl, "resolution", outError, "camera");
+  const tinyxml2::XMLElement *resEl = xmlutils::getRequiredChild(camChildren, "resolution", outError, "camera");
   if (!resEl || !xmlutils::readIntAttribute(resEl, "horizontal", w) || !xmlutils::readIntAttribute(resEl, "vertical", h)) {
     outError = "Missing/invalid <resolution horizontal= vertical=> inside <camera>.";
     return false;
@@ -110,7 +192,7 @@ bool SceneParser::parseCamera(const tinyxml2::XMLElement *xmlElement, Camera &ou
 
   // Read <max_bounces n=>
   int mb = 0;
-  const tinyxml2::XMLElement *mbEl = xmlutils::getRequiredChild(camEl, "max_bounces", outError, "camera");
+  const tinyxml2::XMLElement *mbEl = xmlutils::getRequiredChild(camChildren, "max_bounces", outError, "camera");
   if (!mbEl || !xmlutils::readIntAttribute(mbEl, "n", mb)) {
     outError = "Missing/invalid <max_bounces n=> inside <camera>.";
     return false;
@@ -131,66 +213,28 @@ bool SceneParser::parseCamera(const tinyxml2::XMLElement *xmlElement, Camera &ou
   return true;
 }
 
-// Parse the optional <lights> section of the scene
-bool SceneParser::parseLights(const tinyxml2::XMLElement *sceneEl, Scene &outScene, std::string &outError) const {
-  // Locate <lights> under <scene>
-  const tinyxml2::XMLElement *lightsEl = sceneEl->FirstChildElement("lights");
-  
-  // no <lights> elements 
-  if (!lightsEl)
-    return true;
-
-  // Read all elements in <lights>
-  for (const tinyxml2::XMLElement *el = lightsEl->FirstChildElement();
-       el != nullptr; el = el->NextSiblingElement()) {
-    const char *name = el->Name();
-    if (!name)
-      continue;
-
-    if (std::strcmp(name, "ambient_light") == 0) {
-      if (!parseAmbientLight(el, outScene, outError))
-        return false;
-    } else if (std::strcmp(name, "point_light") == 0) {
-      if (!parsePointLight(el, outScene, outError))
-        return false;
-    } else if (std::strcmp(name, "parallel_light") == 0) {
-      if (!parseParallelLight(el, outScene, outError))
-        return false;
-    } else if (std::strcmp(name, "spot_light") == 0) {
-      if (!parseSpotLight(el, outScene, outError))
-        return false;
-    } else {
-      outError = std::string("Unknown light type <") + name + "> inside <lights>.";
-      return false;
-    }
-  }
-
-  return true;
+// Parse one element of the <lights> section
+bool SceneParser::parseLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const {
+  const char *name = el->Name();
+  if (std::strcmp(name, "ambient_light") == 0)
+    return parseAmbientLight(el, outScene, outError);
+  if (std::strcmp(name, "point_light") == 0)
+    return parsePointLight(el, outScene, outError);
+  if (std::strcmp(name, "parallel_light") == 0)
+    return parseParallelLight(el, outScene, outError);
+  if (std::strcmp(name, "spot_light") == 0)
+    return parseSpotLight(el, outScene, outError);
+  outError = std::string("Unknown light type <") + name + "> inside <lights>.";
+  return false;
 }
 
-bool SceneParser::parseSurfaces(const tinyxml2::XMLElement *sceneEl, Scene &outScene, std::string &outError) const {
-  const tinyxml2::XMLElement *surfacesEl = sceneEl->FirstChildElement("surfaces");
-  if (!surfacesEl)
-    return true; // optional
-
-  for (const tinyxml2::XMLElement *el = surfacesEl->FirstChildElement();
-       el != nullptr; el = el->NextSiblingElement()) {
-
-    const char *name = el->Name();
-    if (!name) continue;
-
-    if (std::strcmp(name, "sphere") == 0) {
-      if (!parseSphere(el, outScene, outError))
-        return false;
-    } else if (std::strcmp(name, "mesh") == 0) {
-      if (!parseMesh(el, outScene, outError))
-        return false;
-    } else {
-      outError = std::string("Unknown surface type <") + name + "> inside <surfaces>.";
-      return false;
-    }
-  }
-
-  return true;
+// Parse one element of the <surfaces> section
+bool SceneParser::parseSurface(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const {
+  const char *name = el->Name();
+  if (std::strcmp(name, "sphere") == 0)
+    return parseSphere(el, outScene, outError);
+  if (std::strcmp(name, "mesh") == 0)
+    return parseMesh(el, outScene, outError);
+  outError = std::string("Unknown surface type <") + name + "> inside <surfaces>.";
+  return false;
 }
-
@@ -3,10 +3,12 @@
 
 #include <string>
 
+#include "parser/xml_parser_utils.h"
 #include "scene/scene.h"
 #include "tinyxml2.h"
 
-// Parses a Scene from the XML format defined by the assignment
+// Parses a Scene from the XML format defined by the assignment, streaming over the lights
+// and surfaces instead of holding the whole document
 class SceneParser {
 public:
   // Loads and parses a scene XML file at 'path' into 'outScene'.
@@ -15,8 +17,10 @@ public:
 private:
   bool parseBasics(const tinyxml2::XMLElement *sceneEl, Scene &outScene, std::string &outError) const;
   bool parseCamera(const tinyxml2::XMLElement *sceneEl, Camera &outCamera, std::string &outError) const;
-  bool parseLights(const tinyxml2::XMLElement *sceneEl, Scene &outScene, std::string &outError) const;
-  bool parseSurfaces(const tinyxml2::XMLElement *sceneEl, Scene &outScene, std::string &outError) const;
+  bool parseFragment(tinyxml2::XMLDocument &doc, const char *begin, const char *end, int line, std::string &outError) const;
+  // one child of <lights> / <surfaces>
+  bool parseLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const;
+  bool parseSurface(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const;
   
   bool parseAmbientLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const;
   bool parsePointLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const;
@@ -25,6 +29,9 @@ private:
 
   bool parseSphere(const tinyxml2::XMLElement *sphereEl, Scene &outScene, std::string &outError) const;
   bool parseMesh(const tinyxml2::XMLElement *meshEl, Scene &outScene, std::string &outError) const;
+
+  bool parseMaterial(const xmlutils::ChildIndex &surface, Material &outMaterial, TextureManager &textures, std::string &outError, const char *ctx) const;
+  bool parseTransform(const xmlutils::ChildIndex &surface, Transform &outTransform, std::string &outError, const char *ctx) const;
 };
 
 #endif
\ No newline at end of file
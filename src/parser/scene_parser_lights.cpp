@@ -7,12 +7,12 @@
 
 namespace {
 // reads a mandatory <color r= g= b=> child
-bool readColorChild(const tinyxml2::XMLElement *parent, Color &out, std::string &outError, const char *ctx) {
-  const tinyxml2::XMLElement *cEl = xmlutils::getRequiredChild(parent, "color", outError, ctx);
+bool readColorChild(const xmlutils::ChildIndex &children, Color &out, std::string &outError, const char *ctx) {
+  const tinyxml2::XMLElement *cEl = xmlutils::getRequiredChild(children, "color", outError, ctx);
   if (!cEl)
     return false;
 
-  if (!xmlutils::readFloatAttribute(cEl, "r", out.x) || !xmlutils::readFloatAttribute(cEl, "g", out.y) || !xmlutils::readFloatAttribute(cEl, "b", out.z)) {
+  if (!xmlutils::readColorAttributes(cEl, out)) {
     outError = std::string(ctx) + ": <color> must have r,g,b float attributes.";
     return false;
   }
@@ -28,8 +28,9 @@ bool SceneParser::parseAmbientLight(const tinyxml2::XMLElement *el, Scene &outSc
   }
 
   AmbientLight a;
+  const xmlutils::ChildIndex children(el);
   Color c{};
-  if (!readColorChild(el, c, outError, "ambient_light"))
+  if (!readColorChild(children, c, outError, "ambient_light"))
     return false;
   a.setColor(c);
 
@@ -39,15 +40,16 @@ bool SceneParser::parseAmbientLight(const tinyxml2::XMLElement *el, Scene &outSc
 
 // Parse <point_light> reads mandatory <color> and <position> and creates and adds the light to the scene
 bool SceneParser::parsePointLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const {
-  auto l = std::make_unique<PointLight>();
+  const xmlutils::ChildIndex children(el);
+  auto l = outScene.arena().make<PointLight>();
 
   Color c{};
-  if (!readColorChild(el, c, outError, "point_light"))
+  if (!readColorChild(children, c, outError, "point_light"))
     return false;
   l->setColor(c);
 
   Vec3 pos{};
-  const tinyxml2::XMLElement *pEl = xmlutils::getRequiredChild(el, "position", outError, "point_light");
+  const tinyxml2::XMLElement *pEl = xmlutils::getRequiredChild(children, "position", outError, "point_light");
   if (!pEl || !xmlutils::readVec3Attributes(pEl, pos)) {
     outError = "point_light: Missing/invalid <position x= y= z=>.";
     return false;
@@ -60,15 +62,16 @@ bool SceneParser::parsePointLight(const tinyxml2::XMLElement *el, Scene &outScen
 
 // Parse <parallel_light> reads mandatory <color> and <direction> and creates and adds the light to the scene (not normalized!)
 bool SceneParser::parseParallelLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const {
-  auto l = std::make_unique<ParallelLight>();
+  const xmlutils::ChildIndex children(el);
+  auto l = outScene.arena().make<ParallelLight>();
 
   Color c{};
-  if (!readColorChild(el, c, outError, "parallel_light"))
+  if (!readColorChild(children, c, outError, "parallel_light"))
     return false;
   l->setColor(c);
 
   Vec3 dir{};
-  const tinyxml2::XMLElement *dEl = xmlutils::getRequiredChild(el, "direction", outError, "parallel_light");
+  const tinyxml2::XMLElement *dEl = xmlutils::getRequiredChild(children, "direction", outError, "parallel_light");
   if (!dEl || !xmlutils::readVec3Attributes(dEl, dir)) {
     outError = "parallel_light: Missing/invalid <direction x= y= z=>.";
     return false;
@@ -79,8 +82,50 @@ bool SceneParser::parseParallelLight(const tinyxml2::XMLElement *el, Scene &outS
   return true;
 }
 
-// Parse <spot_light> not implemented yet
-bool SceneParser::parseSpotLight(const tinyxml2::XMLElement *, Scene &, std::string &outError) const {
-  outError = "<spot_light> not supported yet.";
-  return false;
+// Parse <spot_light> reads mandatory <color>, <position>, <direction> and <falloff alpha1= alpha2=> (degrees)
+// and creates and adds the light to the scene
+bool SceneParser::parseSpotLight(const tinyxml2::XMLElement *el, Scene &outScene, std::string &outError) const {
+  const xmlutils::ChildIndex children(el);
+  auto l = outScene.arena().make<SpotLight>();
+
+  Color c{};
+  if (!readColorChild(children, c, outError, "spot_light"))
+    return false;
+  l->setColor(c);
+
+  Vec3 pos{};
+  const tinyxml2::XMLElement *pEl = xmlutils::getRequiredChild(children, "position", outError, "spot_light");
+  if (!pEl || !xmlutils::readVec3Attributes(pEl, pos)) {
+    outError = "spot_light: Missing/invalid <position x= y= z=>.";
+    return false;
+  }
+  l->setPosition(pos);
+
+  Vec3 dir{};
+  const tinyxml2::XMLElement *dEl = xmlutils::getRequiredChild(children, "direction", outError, "spot_light");
+  if (!dEl || !xmlutils::readVec3Attributes(dEl, dir)) {
+    outError = "spot_light: Missing/invalid <direction x= y= z=>.";
+    return false;
+  }
+  if (dir.length() == 0.f) {
+    outError = "spot_light: <direction> must not be zero.";
+    return false;
+  }
+  l->setDirection(dir); // normalize inside setter
+
+  float alpha1 = 0.f, alpha2 = 0.f;
+  const tinyxml2::XMLElement *fEl = xmlutils::getRequiredChild(children, "falloff", outError, "spot_light");
+  if (!fEl || !xmlutils::readFloatAttributes(fEl, {"alpha1", "alpha2"}, {&alpha1, &alpha2})) {
+    outError = "spot_light: Missing/invalid <falloff alpha1= alpha2=>.";
+    return false;
+  }
+  try {
+    l->setFalloff(alpha1, alpha2);
+  } catch (const std::exception &e) {
+    outError = std::string("spot_light: ") + e.what();
+    return false;
+  }
+
+  outScene.addLight(std::move(l));
+  return true;
 }
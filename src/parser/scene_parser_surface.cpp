@@ -5,15 +5,18 @@
 
 #include "scene/surfaces/sphere.h"
 #include "scene/surfaces/mesh.h"
+#include "util/task_scheduler.h"
 
 #include <cstring>
 #include <filesystem>
 #include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <vector>
 
-static std::vector<TrianglePrimitive> buildTrianglesFromObj(const ObjMeshData& data) {
-  std::vector<TrianglePrimitive> tris;
+// The triangles are allocated from 'resource' (the scene arena)
+static std::pmr::vector<TrianglePrimitive> buildTrianglesFromObj(const ObjMeshData& data, std::pmr::memory_resource *resource) {
+  std::pmr::vector<TrianglePrimitive> tris(resource);
 
   if (data.position.size() % 9 != 0)
     throw std::runtime_error("OBJ expanded position array must be multiple of 9 floats (triangle).");
@@ -28,40 +31,58 @@ static std::vector<TrianglePrimitive> buildTrianglesFromObj(const ObjMeshData& d
   if (hasUVs && data.texcoord.size() != vertexCount * 2)
     throw std::runtime_error("OBJ texcoord array size mismatch.");
 
-  tris.reserve(data.position.size() / 9);
+  tris.resize(data.position.size() / 9);
 
-  size_t uvIdx = 0;
-  for (size_t i = 0; i < data.position.size(); i += 9) {
-    TrianglePrimitive t;
+  parallelFor(0, tris.size(), 4096, [&](size_t begin, size_t end) {
+    for (size_t tri = begin; tri < end; ++tri) {
+      const size_t i = tri * 9;
+      const size_t uvIdx = tri * 6;
+      TrianglePrimitive &t = tris[tri];
 
-    t.v0 = Vec3{data.position[i+0], data.position[i+1], data.position[i+2]};
-    t.v1 = Vec3{data.position[i+3], data.position[i+4], data.position[i+5]};
-    t.v2 = Vec3{data.position[i+6], data.position[i+7], data.position[i+8]};
+      t.v0 = Vec3{data.position[i+0], data.position[i+1], data.position[i+2]};
+      t.v1 = Vec3{data.position[i+3], data.position[i+4], data.position[i+5]};
+      t.v2 = Vec3{data.position[i+6], data.position[i+7], data.position[i+8]};
 
-    if (hasNormals) {
-      t.n0 = Vec3{data.normal[i+0], data.normal[i+1], data.normal[i+2]};
-      t.n1 = Vec3{data.normal[i+3], data.normal[i+4], data.normal[i+5]};
-      t.n2 = Vec3{data.normal[i+6], data.normal[i+7], data.normal[i+8]};
-    } else {
-      // Fallback (besser wäre Face-Normal berechnen, falls du Vec Ops hast)
-      t.n0 = t.n1 = t.n2 = Vec3{0,1,0};
-    }
+      if (hasNormals) {
+        t.n0 = Vec3{data.normal[i+0], data.normal[i+1], data.normal[i+2]};
+        t.n1 = Vec3{data.normal[i+3], data.normal[i+4], data.normal[i+5]};
+        t.n2 = Vec3{data.normal[i+6], data.normal[i+7], data.normal[i+8]};
+      } else {
+        // Fallback (besser wäre Face-Normal berechnen, falls du Vec Ops hast)
+        t.n0 = t.n1 = t.n2 = Vec3{0,1,0};
+      }
 
-    if (hasUVs) {
-      t.uv0 = Vec3{data.texcoord[uvIdx+0], data.texcoord[uvIdx+1], 0};
-      t.uv1 = Vec3{data.texcoord[uvIdx+2], data.texcoord[uvIdx+3], 0};
-      t.uv2 = Vec3{data.texcoord[uvIdx+4], data.texcoord[uvIdx+5], 0};
-      uvIdx += 6;
-    } else {
-      t.uv0 = t.uv1 = t.uv2 = Vec3{0,0,0};
+      if (hasUVs) {
+        t.uv0 = Vec3{data.texcoord[uvIdx+0], data.texcoord[uvIdx+1], 0};
+        t.uv1 = Vec3{data.texcoord[uvIdx+2], data.texcoord[uvIdx+3], 0};
+        t.uv2 = Vec3{data.texcoord[uvIdx+4], data.texcoord[uvIdx+5], 0};
+      } else {
+        t.uv0 = t.uv1 = t.uv2 = Vec3{0,0,0};
+      }
     }
-
-    tris.push_back(t);
-  }
+  });
 
   return tris;
 }
 
+// Meshes are intersected in world space, so their transform is applied to the vertex data once
+static void bakeTransform(std::pmr::vector<TrianglePrimitive> &tris, const Transform &transform) {
+  auto normal = [&transform](const Vec3 &n) {
+    return n.lengthSquared() > 0.f ? transform.applyNormal(n).normalized() : n;
+  };
+  parallelFor(0, tris.size(), 4096, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      TrianglePrimitive &t = tris[i];
+      t.v0 = transform.applyPoint(t.v0);
+      t.v1 = transform.applyPoint(t.v1);
+      t.v2 = transform.applyPoint(t.v2);
+      t.n0 = normal(t.n0);
+      t.n1 = normal(t.n1);
+      t.n2 = normal(t.n2);
+    }
+  });
+}
+
 bool SceneParser::parseSphere(const tinyxml2::XMLElement *sphereEl, Scene &outScene, std::string &outError) const {
   float radius = 1.0f;
   if (!xmlutils::readFloatAttribute(sphereEl, "radius", radius)) {
@@ -69,8 +90,9 @@ bool SceneParser::parseSphere(const tinyxml2::XMLElement *sphereEl, Scene &outSc
     return false;
   }
 
+  const xmlutils::ChildIndex children(sphereEl);
   const tinyxml2::XMLElement *posEl =
-      xmlutils::getRequiredChild(sphereEl, "position", outError, "sphere");
+      xmlutils::getRequiredChild(children, "position", outError, "sphere");
   if (!posEl) return false;
 
   Vec3 center{};
@@ -79,11 +101,19 @@ bool SceneParser::parseSphere(const tinyxml2::XMLElement *sphereEl, Scene &outSc
     return false;
   }
 
-  auto s = std::make_unique<Sphere>();
+  Material material;
+  if (!parseMaterial(children, material, outScene.texturesMutable(), outError, "sphere"))
+    return false;
+
+  Transform transform;
+  if (!parseTransform(children, transform, outError, "sphere"))
+    return false;
+
+  auto s = outScene.arena().make<Sphere>();
   s->setRadius(radius);
   s->setCenterPosition(center);
-
-  // TODO: Material/Transform (wenn du es später willst)
+  s->setMaterial(std::move(material));
+  s->setTransform(transform);
 
   outScene.addSurface(std::move(s));
   return true;
@@ -96,6 +126,15 @@ bool SceneParser::parseMesh(const tinyxml2::XMLElement *meshEl, Scene &outScene,
     return false;
   }
 
+  const xmlutils::ChildIndex children(meshEl);
+  Material material;
+  if (!parseMaterial(children, material, outScene.texturesMutable(), outError, "mesh"))
+    return false;
+
+  Transform transform;
+  if (!parseTransform(children, transform, outError, "mesh"))
+    return false;
+
   try {
     // Schutz gegen Pfad-Traversal: nur Dateiname verwenden
     std::filesystem::path fileName = std::filesystem::path(nameAttr).filename();
@@ -104,13 +143,14 @@ bool SceneParser::parseMesh(const tinyxml2::XMLElement *meshEl, Scene &outScene,
     std::string objText = xmlutils::readTextFileOrThrow(objPath);
     ObjMeshData data = parseObj(objText);
 
-    std::vector<TrianglePrimitive> tris = buildTrianglesFromObj(data);
+    std::pmr::vector<TrianglePrimitive> tris = buildTrianglesFromObj(data, outScene.arena().resource());
+    if (!transform.isIdentity())
+      bakeTransform(tris, transform);
 
-    auto m = std::make_unique<Mesh>();
+    auto m = outScene.arena().make<Mesh>(outScene.arena().resource());
+    m->setMaterial(std::move(material));
     m->setTrianglePrimitives(std::move(tris));
 
-    // TODO: Material/Transform (wenn du es später willst)
-
     outScene.addSurface(std::move(m));
     return true;
   } catch (const std::exception &e) {
@@ -118,3 +158,114 @@ bool SceneParser::parseMesh(const tinyxml2::XMLElement *meshEl, Scene &outScene,
     return false;
   }
 }
+
+// Parse <material_solid> or <material_textured> of a surface, both share phong/reflectance/transmittance/refraction
+bool SceneParser::parseMaterial(const xmlutils::ChildIndex &surface, Material &outMaterial, TextureManager &textures, std::string &outError, const char *ctx) const {
+  const tinyxml2::XMLElement *matEl = surface.find("material_solid");
+  const xmlutils::ChildIndex matChildren(matEl ? matEl : surface.find("material_textured"));
+  if (matEl) {
+    outMaterial.setType(MaterialType::SOLID);
+
+    Color c{};
+    const tinyxml2::XMLElement *cEl = xmlutils::getRequiredChild(matChildren, "color", outError, "material_solid");
+    if (!cEl)
+      return false;
+    if (!xmlutils::readColorAttributes(cEl, c)) {
+      outError = std::string(ctx) + ": <material_solid><color> must have r,g,b float attributes.";
+      return false;
+    }
+    outMaterial.setColor(c);
+  } else {
+    matEl = matChildren.parent();
+    if (!matEl) {
+      outError = std::string("Missing <material_solid> or <material_textured> inside <") + ctx + ">.";
+      return false;
+    }
+    outMaterial.setType(MaterialType::TEXTURED);
+
+    const tinyxml2::XMLElement *texEl = xmlutils::getRequiredChild(matChildren, "texture", outError, "material_textured");
+    if (!texEl)
+      return false;
+    const char *texName = texEl->Attribute("name");
+    if (!texName || std::string(texName).empty()) {
+      outError = std::string(ctx) + ": <texture> is missing attribute 'name'.";
+      return false;
+    }
+    outMaterial.setTextureName(texName);
+    // decoded after parsing, together with all other textures
+    outMaterial.setTexture(textures.request(texName));
+  }
+
+  PhongParams phong;
+  const tinyxml2::XMLElement *phongEl = xmlutils::getRequiredChild(matChildren, "phong", outError, matEl->Name());
+  if (!phongEl)
+    return false;
+  if (!xmlutils::readFloatAttributes(phongEl, {"ka", "kd", "ks", "exponent"},
+                                     {&phong.kAmbient, &phong.kDiffuse, &phong.kSpecular, &phong.exponentShininess})) {
+    outError = std::string(ctx) + ": <phong> must have ka, kd, ks, exponent float attributes.";
+    return false;
+  }
+  outMaterial.setPhong(phong);
+
+  float r = 0.f, t = 0.f, ior = 1.f;
+  const tinyxml2::XMLElement *rEl = xmlutils::getRequiredChild(matChildren, "reflectance", outError, matEl->Name());
+  if (!rEl || !xmlutils::readFloatAttribute(rEl, "r", r)) {
+    outError = std::string(ctx) + ": Missing/invalid <reflectance r=>.";
+    return false;
+  }
+  const tinyxml2::XMLElement *tEl = xmlutils::getRequiredChild(matChildren, "transmittance", outError, matEl->Name());
+  if (!tEl || !xmlutils::readFloatAttribute(tEl, "t", t)) {
+    outError = std::string(ctx) + ": Missing/invalid <transmittance t=>.";
+    return false;
+  }
+  const tinyxml2::XMLElement *iorEl = xmlutils::getRequiredChild(matChildren, "refraction", outError, matEl->Name());
+  if (!iorEl || !xmlutils::readFloatAttribute(iorEl, "iof", ior)) {
+    outError = std::string(ctx) + ": Missing/invalid <refraction iof=>.";
+    return false;
+  }
+  outMaterial.setReflectance(r);
+  outMaterial.setTransmittance(t);
+  outMaterial.setIor(ior);
+  return true;
+}
+
+// Parse the optional <transform> of a surface, operations are composed in document order
+bool SceneParser::parseTransform(const xmlutils::ChildIndex &surface, Transform &outTransform, std::string &outError, const char *ctx) const {
+  const tinyxml2::XMLElement *transformEl = surface.find("transform");
+  if (!transformEl)
+    return true; // optional
+
+  for (const tinyxml2::XMLElement *el = transformEl->FirstChildElement();
+       el != nullptr; el = el->NextSiblingElement()) {
+    const char *name = el->Name();
+    if (!name) continue;
+
+    if (std::strcmp(name, "translate") == 0 || std::strcmp(name, "scale") == 0) {
+      Vec3 v{};
+      if (!xmlutils::readVec3Attributes(el, v)) {
+        outError = std::string(ctx) + ": <" + name + "> must have x,y,z float attributes.";
+        return false;
+      }
+      if (name[0] == 't')
+        outTransform.translate(v);
+      else
+        outTransform.scale(v);
+    } else if (std::strcmp(name, "rotateX") == 0 || std::strcmp(name, "rotateY") == 0 || std::strcmp(name, "rotateZ") == 0) {
+      float theta = 0.f;
+      if (!xmlutils::readFloatAttribute(el, "theta", theta)) {
+        outError = std::string(ctx) + ": <" + name + "> must have float attribute theta.";
+        return false;
+      }
+      if (name[6] == 'X')
+        outTransform.rotateX(theta);
+      else if (name[6] == 'Y')
+        outTransform.rotateY(theta);
+      else
+        outTransform.rotateZ(theta);
+    } else {
+      outError = std::string("Unknown transform <") + name + "> inside <" + ctx + ">.";
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,491 @@
+#include "parser/scene_snapshot.h"
+
+#include "scene/surfaces/mesh.h"
+#include "scene/surfaces/sphere.h"
+#include "util/mapped_file.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'T', 'S', 'N'};
+constexpr size_t kArrayAlignment = 16;
+// sanity bound for texture levels, keeps corrupt sizes from allocating huge levels
+constexpr int32_t kMaxTextureSize = 1 << 16;
+
+// stored as raw bytes, a snapshot is only valid for builds where these match
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t triangleSize;
+  uint32_t nodeSize;
+  uint32_t transformSize;
+  uint32_t reserved;
+  uint64_t fileSize;
+};
+
+static_assert(std::is_trivially_copyable_v<TrianglePrimitive>);
+static_assert(std::is_trivially_copyable_v<BVHNode>);
+static_assert(std::is_trivially_copyable_v<Transform>);
+
+Header currentHeader() {
+  Header h{};
+  std::memcpy(h.magic, kMagic, 4);
+  h.version = kSnapshotVersion;
+  h.triangleSize = sizeof(TrianglePrimitive);
+  h.nodeSize = sizeof(BVHNode);
+  h.transformSize = sizeof(Transform);
+  return h;
+}
+
+class Writer {
+public:
+  explicit Writer(std::FILE *f) : f_(f) {}
+
+  void bytes(const void *data, size_t size) {
+    if (size > 0 && std::fwrite(data, 1, size, f_) != size)
+      ok_ = false;
+    offset_ += size;
+  }
+
+  template <class T>
+  void pod(const T &v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    bytes(&v, sizeof(T));
+  }
+
+  void string(const std::string &s) {
+    pod(static_cast<uint32_t>(s.size()));
+    bytes(s.data(), s.size());
+  }
+
+  template <class T>
+  void array(const T *data, size_t count) {
+    pod(static_cast<uint64_t>(count));
+    static const char kZeros[kArrayAlignment] = {};
+    bytes(kZeros, (kArrayAlignment - offset_ % kArrayAlignment) % kArrayAlignment);
+    bytes(data, count * sizeof(T));
+  }
+
+  bool ok() const {
+    return ok_;
+  }
+  uint64_t offset() const {
+    return offset_;
+  }
+
+private:
+  std::FILE *f_;
+  uint64_t offset_ = 0;
+  bool ok_ = true;
+};
+
+// Reads records from the mapped file, every read is bounds checked
+class Reader {
+public:
+  Reader(const unsigned char *data, size_t size) : data_(data), size_(size) {}
+
+  bool bytes(void *out, size_t size) {
+    if (size > size_ - pos_)
+      return false;
+    std::memcpy(out, data_ + pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  template <class T>
+  bool pod(T &v) {
+    return bytes(&v, sizeof(T));
+  }
+
+  bool string(std::string &s) {
+    uint32_t size;
+    if (!pod(size) || size > size_ - pos_)
+      return false;
+    s.assign(reinterpret_cast<const char *>(data_ + pos_), size);
+    pos_ += size;
+    return true;
+  }
+
+  // pointer to 'count' elements in the mapping
+  template <class T>
+  bool array(const T *&out, size_t &count) {
+    uint64_t n;
+    if (!pod(n))
+      return false;
+    pos_ += (kArrayAlignment - pos_ % kArrayAlignment) % kArrayAlignment;
+    if (pos_ > size_ || n > (size_ - pos_) / sizeof(T))
+      return false;
+    out = reinterpret_cast<const T *>(data_ + pos_);
+    count = static_cast<size_t>(n);
+    pos_ += count * sizeof(T);
+    return true;
+  }
+
+private:
+  const unsigned char *data_;
+  size_t size_;
+  size_t pos_ = 0;
+};
+
+void writeMaterial(Writer &w, const Material &m, int32_t texture) {
+  w.pod(static_cast<uint8_t>(m.type()));
+  w.pod(m.color());
+  w.pod(texture);
+  w.pod(m.phong());
+  w.pod(m.reflectance());
+  w.pod(m.transmittance());
+  w.pod(m.ior());
+}
+
+bool readMaterial(Reader &r, Material &m, const std::vector<std::shared_ptr<const Texture>> &textures) {
+  uint8_t type;
+  Color color;
+  int32_t texture;
+  PhongParams phong;
+  float reflectance, transmittance, ior;
+  if (!r.pod(type) || !r.pod(color) || !r.pod(texture) || !r.pod(phong) || !r.pod(reflectance) ||
+      !r.pod(transmittance) || !r.pod(ior))
+    return false;
+  if (type > static_cast<uint8_t>(MaterialType::TEXTURED) || texture < -1 || texture >= static_cast<int32_t>(textures.size()))
+    return false;
+  m.setType(static_cast<MaterialType>(type));
+  m.setColor(color);
+  if (texture >= 0) {
+    m.setTextureName(textures[texture]->name());
+    m.setTexture(textures[texture]);
+  }
+  m.setPhong(phong);
+  m.setReflectance(reflectance);
+  m.setTransmittance(transmittance);
+  m.setIor(ior);
+  return true;
+}
+
+bool readRecords(Reader &r, Scene &outScene, std::string &outError) {
+  auto corrupt = [&outError](const char *what) {
+    outError = std::string("Snapshot is truncated or corrupt (") + what + ").";
+    return false;
+  };
+
+  std::string outputFileName;
+  Color background;
+  if (!r.string(outputFileName) || !r.pod(background))
+    return corrupt("scene");
+  outScene.setOutputFileName(outputFileName);
+  outScene.setBackgroundColor(background);
+
+  Vec3 position, lookat, up;
+  float fov;
+  int32_t width, height, maxBounces;
+  if (!r.pod(position) || !r.pod(lookat) || !r.pod(up) || !r.pod(fov) || !r.pod(width) || !r.pod(height) ||
+      !r.pod(maxBounces))
+    return corrupt("camera");
+  try {
+    Camera &camera = outScene.cameraMutable();
+    camera.setPosition(position);
+    camera.setLookat(lookat);
+    camera.setUp(up);
+    camera.setHorizontalFovHalfAngle(fov);
+    camera.setResolution(width, height);
+    camera.setMaxBounces(maxBounces);
+  } catch (const std::exception &e) {
+    outError = std::string("Snapshot camera values invalid: ") + e.what();
+    return false;
+  }
+
+  uint8_t hasAmbient;
+  Color ambient;
+  if (!r.pod(hasAmbient) || !r.pod(ambient))
+    return corrupt("ambient light");
+  if (hasAmbient) {
+    AmbientLight a;
+    a.setColor(ambient);
+    outScene.setAmbientLight(a);
+  }
+
+  // textures in the order materials refer to them
+  uint32_t textureCount;
+  if (!r.pod(textureCount))
+    return corrupt("textures");
+  std::vector<std::shared_ptr<const Texture>> textures;
+  TextureManager &manager = outScene.texturesMutable();
+  for (uint32_t i = 0; i < textureCount; ++i) {
+    std::string name;
+    uint8_t layout, paged;
+    if (!r.string(name) || !r.pod(layout) || !r.pod(paged) || layout > static_cast<uint8_t>(TextureLayout::Z_ORDER))
+      return corrupt("texture");
+    if (paged) {
+      textures.push_back(manager.request(name));
+      continue;
+    }
+    uint32_t levels;
+    if (!r.pod(levels))
+      return corrupt("texture");
+    auto texture = std::make_shared<Texture>(name, static_cast<TextureLayout>(layout));
+    for (uint32_t l = 0; l < levels; ++l) {
+      int32_t w, h;
+      const uint8_t *texels;
+      size_t bytes;
+      if (!r.pod(w) || !r.pod(h) || w <= 0 || h <= 0 || w > kMaxTextureSize || h > kMaxTextureSize ||
+          !r.array(texels, bytes) || !texture->appendLevel(w, h, texels, bytes))
+        return corrupt("texture level");
+    }
+    manager.add(texture);
+    textures.push_back(std::move(texture));
+  }
+
+  uint32_t lightCount;
+  if (!r.pod(lightCount))
+    return corrupt("lights");
+  for (uint32_t i = 0; i < lightCount; ++i) {
+    uint8_t type;
+    Color color;
+    if (!r.pod(type) || !r.pod(color))
+      return corrupt("light");
+    if (type == static_cast<uint8_t>(LightType::POINT)) {
+      Vec3 p;
+      if (!r.pod(p))
+        return corrupt("point light");
+      auto l = outScene.arena().make<PointLight>();
+      l->setColor(color);
+      l->setPosition(p);
+      outScene.addLight(std::move(l));
+    } else if (type == static_cast<uint8_t>(LightType::PARALLEL)) {
+      Vec3 d;
+      if (!r.pod(d))
+        return corrupt("parallel light");
+      auto l = outScene.arena().make<ParallelLight>();
+      l->setColor(color);
+      l->setUnitDirection(d);
+      outScene.addLight(std::move(l));
+    } else if (type == static_cast<uint8_t>(LightType::SPOT)) {
+      Vec3 p, d;
+      float alpha1, alpha2;
+      if (!r.pod(p) || !r.pod(d) || !r.pod(alpha1) || !r.pod(alpha2))
+        return corrupt("spot light");
+      auto l = outScene.arena().make<SpotLight>();
+      l->setColor(color);
+      l->setPosition(p);
+      l->setUnitDirection(d);
+      try {
+        l->setFalloff(alpha1, alpha2);
+      } catch (const std::exception &e) {
+        outError = std::string("Snapshot spot light invalid: ") + e.what();
+        return false;
+      }
+      outScene.addLight(std::move(l));
+    } else {
+      return corrupt("light type");
+    }
+  }
+
+  uint32_t surfaceCount;
+  if (!r.pod(surfaceCount))
+    return corrupt("surfaces");
+  std::pmr::memory_resource *resource = outScene.arena().resource();
+  for (uint32_t i = 0; i < surfaceCount; ++i) {
+    uint8_t type;
+    Material material;
+    Transform transform;
+    uint8_t transformed;
+    if (!r.pod(type) || !readMaterial(r, material, textures) || !r.pod(transformed) ||
+        (transformed && !r.bytes(&transform, sizeof(Transform))))
+      return corrupt("surface");
+    if (type == static_cast<uint8_t>(SurfaceType::SPHERE)) {
+      Vec3 center;
+      float radius;
+      if (!r.pod(center) || !r.pod(radius))
+        return corrupt("sphere");
+      auto s = outScene.arena().make<Sphere>();
+      s->setCenterPosition(center);
+      s->setRadius(radius);
+      s->setMaterial(std::move(material));
+      s->setTransform(transform);
+      outScene.addSurface(std::move(s));
+    } else if (type == static_cast<uint8_t>(SurfaceType::MESH)) {
+      const TrianglePrimitive *tris;
+      const BVHNode *nodes;
+      size_t triCount, nodeCount;
+      if (!r.array(tris, triCount) || !r.array(nodes, nodeCount))
+        return corrupt("mesh");
+      // leaves must reference existing triangles, interior nodes two distinct later children.
+      // Every node has at most one parent and lies within the traversal stack's depth, so a
+      // crafted file can neither overflow the stack nor share subtrees.
+      std::vector<uint8_t> depth(nodeCount, 0), parents(nodeCount, 0);
+      for (size_t n = 0; n < nodeCount; ++n) {
+        const BVHNode &node = nodes[n];
+        if (node.count > 0) {
+          if (node.offset + size_t{node.count} > triCount)
+            return corrupt("mesh hierarchy");
+          continue;
+        }
+        if (node.offset <= n + 1 || node.offset >= nodeCount || depth[n] >= TriangleBVH::kMaxDepth)
+          return corrupt("mesh hierarchy");
+        for (const size_t child : {n + 1, size_t{node.offset}}) {
+          if (parents[child]++ > 0)
+            return corrupt("mesh hierarchy");
+          depth[child] = static_cast<uint8_t>(depth[n] + 1);
+        }
+      }
+      auto m = outScene.arena().make<Mesh>(resource);
+      m->setPrebuilt(std::pmr::vector<TrianglePrimitive>(tris, tris + triCount, resource), nodes, nodeCount);
+      m->setMaterial(std::move(material));
+      m->setTransform(transform);
+      outScene.addSurface(std::move(m));
+    } else {
+      return corrupt("surface type");
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+bool saveSceneSnapshot(const Scene &scene, const std::string &path, std::string &outError) {
+  // written next to the target and renamed, a failed save never leaves a partial snapshot
+  const std::string tmp = path + ".tmp";
+  std::FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) {
+    outError = "Cannot write " + tmp + ": " + std::strerror(errno);
+    return false;
+  }
+  Writer w(f);
+  Header header = currentHeader();
+  w.pod(header);
+
+  w.string(scene.outputFileName());
+  w.pod(scene.backgroundColor());
+  const Camera &camera = scene.camera();
+  w.pod(camera.position());
+  w.pod(camera.lookat());
+  w.pod(camera.up());
+  w.pod(camera.horizontalFovHalfAngle());
+  w.pod(static_cast<int32_t>(camera.resHorizontal()));
+  w.pod(static_cast<int32_t>(camera.resVertical()));
+  w.pod(static_cast<int32_t>(camera.maxBounces()));
+
+  w.pod(static_cast<uint8_t>(scene.ambientLight() ? 1 : 0));
+  w.pod(scene.ambientLight() ? scene.ambientLight()->color() : Color{});
+
+  // textures referenced by materials, numbered in order of first use
+  std::vector<const Texture *> textures;
+  std::unordered_map<const Texture *, int32_t> textureIndex;
+  auto indexOf = [&](const Material &m) -> int32_t {
+    if (!m.texture())
+      return -1;
+    auto it = textureIndex.emplace(m.texture(), static_cast<int32_t>(textures.size()));
+    if (it.second)
+      textures.push_back(m.texture());
+    return it.first->second;
+  };
+  for (const auto &s : scene.surfaces())
+    indexOf(s->material());
+
+  w.pod(static_cast<uint32_t>(textures.size()));
+  for (const Texture *t : textures) {
+    w.string(t->name());
+    w.pod(static_cast<uint8_t>(t->layout()));
+    w.pod(static_cast<uint8_t>(t->paged() ? 1 : 0));
+    if (t->paged())
+      continue;
+    w.pod(static_cast<uint32_t>(t->levelCount()));
+    for (int l = 0; l < t->levelCount(); ++l) {
+      w.pod(static_cast<int32_t>(t->levelWidth(l)));
+      w.pod(static_cast<int32_t>(t->levelHeight(l)));
+      w.array(t->levelData(l), t->levelBytes(l));
+    }
+  }
+
+  w.pod(static_cast<uint32_t>(scene.lights().size()));
+  for (const auto &light : scene.lights()) {
+    w.pod(static_cast<uint8_t>(light->type()));
+    w.pod(light->color());
+    if (light->type() == LightType::POINT) {
+      w.pod(static_cast<const PointLight &>(*light).position());
+    } else if (light->type() == LightType::PARALLEL) {
+      w.pod(static_cast<const ParallelLight &>(*light).direction());
+    } else if (light->type() == LightType::SPOT) {
+      const auto &spot = static_cast<const SpotLight &>(*light);
+      w.pod(spot.position());
+      w.pod(spot.direction());
+      w.pod(spot.alpha1());
+      w.pod(spot.alpha2());
+    }
+  }
+
+  w.pod(static_cast<uint32_t>(scene.surfaces().size()));
+  for (const auto &s : scene.surfaces()) {
+    w.pod(static_cast<uint8_t>(s->type()));
+    writeMaterial(w, s->material(), indexOf(s->material()));
+    // most surfaces are untransformed, only other transforms are stored
+    w.pod(static_cast<uint8_t>(s->transform().isIdentity() ? 0 : 1));
+    if (!s->transform().isIdentity())
+      w.bytes(&s->transform(), sizeof(Transform));
+    if (s->type() == SurfaceType::SPHERE) {
+      const auto &sphere = static_cast<const Sphere &>(*s);
+      w.pod(sphere.centerPosition());
+      w.pod(sphere.radius());
+    } else {
+      const auto &mesh = static_cast<const Mesh &>(*s);
+      w.array(mesh.triangles().data(), mesh.triangles().size());
+      w.array(mesh.bvh().nodes().data(), mesh.bvh().nodes().size());
+    }
+  }
+
+  // the header carries the final size to detect truncated files
+  header.fileSize = w.offset();
+  const bool ok = w.ok() && std::fseek(f, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, f) == 1;
+  if (std::fclose(f) != 0 || !ok) {
+    std::remove(tmp.c_str());
+    outError = "Writing " + tmp + " failed.";
+    return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    std::remove(tmp.c_str());
+    outError = "Could not replace " + path + ": " + ec.message();
+    return false;
+  }
+  return true;
+}
+
+bool loadSceneSnapshot(const std::string &path, Scene &outScene, std::string &outError) {
+  MappedFile file;
+  if (!file.open(path, outError))
+    return false;
+
+  // array offsets are aligned relative to the start of the file, like when writing
+  Reader r(file.data(), file.size());
+  Header header;
+  const Header expected = currentHeader();
+  if (!r.pod(header) || std::memcmp(header.magic, kMagic, 4) != 0) {
+    outError = path + " is not a scene snapshot.";
+    return false;
+  }
+  if (header.version != expected.version || header.triangleSize != expected.triangleSize ||
+      header.nodeSize != expected.nodeSize || header.transformSize != expected.transformSize) {
+    outError = path + " was written by an incompatible build (snapshot version " + std::to_string(header.version) +
+               ", expected " + std::to_string(expected.version) + "), re-create it from the XML scene.";
+    return false;
+  }
+  if (header.fileSize != file.size()) {
+    outError = path + " is truncated.";
+    return false;
+  }
+
+  if (!readRecords(r, outScene, outError))
+    return false;
+  // paged textures are converted/opened like when parsing the XML
+  return outScene.texturesMutable().loadPending(outError);
+}
@@ -0,0 +1,27 @@
+#ifndef SCENE_SNAPSHOT_H
+#define SCENE_SNAPSHOT_H
+
+#include <string>
+
+#include "scene/scene.h"
+
+// Binary dump of a fully loaded Scene: camera, lights, materials, world space mesh triangles
+// with their BVHs and decoded in-memory textures. Loading maps the file and copies the arrays
+// into the scene as they are, without any parsing or rebuilding, so re-renders of a scene
+// skip the XML/OBJ/PNG work.
+//
+// Layout: header "RTSN", format version, the sizes of the raw structs it contains and the
+// file size, followed by the scene records in a fixed order. Arrays are prefixed with their
+// element count and start at 16 byte offsets, so they can be used in place from a mapping.
+// Numbers are stored in host byte order: a snapshot is a local cache of the XML scene, not an
+// exchange format. Any change to the records or raw structs must bump kSnapshotVersion.
+//
+// Paged textures (tile cache) are stored by name and paged in again when loading.
+constexpr uint32_t kSnapshotVersion = 1;
+
+bool saveSceneSnapshot(const Scene &scene, const std::string &path, std::string &outError);
+
+// 'outScene' must be empty, its texture manager configuration applies to paged textures
+bool loadSceneSnapshot(const std::string &path, Scene &outScene, std::string &outError);
+
+#endif
@@ -1,12 +1,36 @@
 #include "xml_parser_utils.h"
 
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
 namespace xmlutils {
 
+namespace {
+// from_chars instead of tinyxml2's sscanf, accepting the same decimal input: leading
+// whitespace and '+' are skipped and trailing characters are ignored
+bool parseFloat(const char *s, float &out) {
+  while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r')
+    ++s;
+  if (s[0] == '+' && s[1] != '-')
+    ++s;
+  const std::from_chars_result r = std::from_chars(s, s + std::strlen(s), out);
+  return r.ec == std::errc();
+}
+
+void missingChildError(const char *childName, std::string &outError, const char *contextName) {
+  if (contextName) {
+    outError = std::string("Missing <") + childName + "> inside <" + contextName + ">.";
+  } else {
+    outError = std::string("Missing <") + childName + ">.";
+  }
+}
+} // namespace
+
 // Returns true on success, false if element is null or attribute is missing/invalid.
 bool readFloatAttribute(const tinyxml2::XMLElement *element, const char *name, float &out) {
-  if (!element)
-    return false;
-  return element->QueryFloatAttribute(name, &out) == tinyxml2::XML_SUCCESS;
+  float *target = &out;
+  return readFloatAttributes(element, &name, &target, 1);
 }
 
 // Returns true on success, false if element is null or attribute is missing/invalid.
@@ -15,13 +39,55 @@ bool readIntAttribute(const tinyxml2::XMLElement *element, const char *name, int
     return false;
   return element->QueryIntAttribute(name, &out) == tinyxml2::XML_SUCCESS;
 }
-// Returns true on success, false if any attribute is missing/invalid.
-bool readVec3Attributes(const tinyxml2::XMLElement *element, Vec3 &out) {
+
+// Returns true on success, false if element is null or any attribute is missing/invalid.
+bool readFloatAttributes(const tinyxml2::XMLElement *element, const char *const *names, float *const *out, size_t count) {
   if (!element)
     return false;
-  return element->QueryFloatAttribute("x", &out.x) == tinyxml2::XML_SUCCESS &&
-         element->QueryFloatAttribute("y", &out.y) == tinyxml2::XML_SUCCESS &&
-         element->QueryFloatAttribute("z", &out.z) == tinyxml2::XML_SUCCESS;
+  uint32_t found = 0;
+  for (const tinyxml2::XMLAttribute *a = element->FirstAttribute(); a; a = a->Next()) {
+    const char *name = a->Name();
+    for (size_t i = 0; i < count; ++i) {
+      if (std::strcmp(name, names[i]) != 0)
+        continue;
+      if (!parseFloat(a->Value(), *out[i]))
+        return false;
+      found |= 1u << i;
+      break;
+    }
+  }
+  return found == static_cast<uint32_t>((uint64_t{1} << count) - 1);
+}
+
+// Returns true on success, false if any attribute is missing/invalid.
+bool readVec3Attributes(const tinyxml2::XMLElement *element, Vec3 &out) {
+  return readFloatAttributes(element, {"x", "y", "z"}, {&out.x, &out.y, &out.z});
+}
+
+// Returns true on success, false if any attribute is missing/invalid.
+bool readColorAttributes(const tinyxml2::XMLElement *element, Color &out) {
+  return readFloatAttributes(element, {"r", "g", "b"}, {&out.x, &out.y, &out.z});
+}
+
+ChildIndex::ChildIndex(const tinyxml2::XMLElement *parent) : parent_(parent) {
+  if (!parent)
+    return;
+  for (const tinyxml2::XMLElement *el = parent->FirstChildElement(); el; el = el->NextSiblingElement()) {
+    if (count_ == kMaxChildren) {
+      complete_ = false;
+      break;
+    }
+    entries_[count_++] = Entry{el->Name(), el};
+  }
+}
+
+const tinyxml2::XMLElement *ChildIndex::find(const char *childName) const {
+  const std::string_view name(childName);
+  for (size_t i = 0; i < count_; ++i) {
+    if (entries_[i].name == name)
+      return entries_[i].element;
+  }
+  return complete_ || !parent_ ? nullptr : parent_->FirstChildElement(childName);
 }
 
 // Finds a required child element by name.
@@ -32,14 +98,21 @@ const tinyxml2::XMLElement *getRequiredChild(const tinyxml2::XMLElement *parent,
   }
 
   const tinyxml2::XMLElement *child = parent->FirstChildElement(childName);
-  if (!child) {
-    if (contextName) {
-      outError = std::string("Missing <") + childName + "> inside <" + contextName + ">.";
-    } else {
-      outError = std::string("Missing <") + childName + ">.";
-    }
+  if (!child)
+    missingChildError(childName, outError, contextName);
+  return child;
+}
+
+// Same as above, looked up in an index of the parent's children.
+const tinyxml2::XMLElement *getRequiredChild(const ChildIndex &children, const char *childName, std::string &outError, const char *contextName) {
+  if (!children.parent()) {
+    outError = "Internal error: parent element is null.";
     return nullptr;
   }
+
+  const tinyxml2::XMLElement *child = children.find(childName);
+  if (!child)
+    missingChildError(childName, outError, contextName);
   return child;
 }
 
@@ -3,7 +3,9 @@
 
 #include "scene/scene.h"
 #include "tinyxml2.h"
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <filesystem>  
 #include <fstream>
 #include <sstream>
@@ -14,10 +16,49 @@ namespace xmlutils {
 bool readFloatAttribute(const tinyxml2::XMLElement *element, const char *name, float &out);
 // Tries to read an int attribute 'name' from 'element' into 'out'
 bool readIntAttribute(const tinyxml2::XMLElement *element, const char *name, int &out);
+// Reads the float attributes names[i] into *out[i] in a single walk over the attribute list
+// (count <= 32), false if any of them is missing or invalid
+bool readFloatAttributes(const tinyxml2::XMLElement *element, const char *const *names, float *const *out, size_t count);
+template <size_t N>
+bool readFloatAttributes(const tinyxml2::XMLElement *element, const char *const (&names)[N], float *const (&out)[N]) {
+  static_assert(N <= 32, "at most 32 attributes per call");
+  return readFloatAttributes(element, names, out, N);
+}
 // Reads x/y/z float attributes into a Vec3
 bool readVec3Attributes(const tinyxml2::XMLElement *element, Vec3 &out);
+// Reads r/g/b float attributes into a Color
+bool readColorAttributes(const tinyxml2::XMLElement *element, Color &out);
+
+// The element children of 'parent', collected in one walk over the sibling list so that
+// looking up several children does not rescan it each time. Like FirstChildElement() the
+// first child of a name wins. Parents with more children than fit are still answered
+// correctly by falling back to a scan.
+class ChildIndex {
+public:
+  explicit ChildIndex(const tinyxml2::XMLElement *parent);
+
+  const tinyxml2::XMLElement *parent() const {
+    return parent_;
+  }
+  // nullptr if there is no child <childName>
+  const tinyxml2::XMLElement *find(const char *childName) const;
+
+private:
+  static constexpr size_t kMaxChildren = 16;
+  struct Entry {
+    std::string_view name;
+    const tinyxml2::XMLElement *element;
+  };
+
+  const tinyxml2::XMLElement *parent_;
+  Entry entries_[kMaxChildren];
+  size_t count_ = 0;
+  bool complete_ = true;
+};
+
 // Finds a required child element <childName> under 'parent'
 const tinyxml2::XMLElement *getRequiredChild(const tinyxml2::XMLElement *parent, const char *childName, std::string &outError, const char *contextName);
+const tinyxml2::XMLElement *getRequiredChild(const ChildIndex &children, const char *childName, std::string &outError, const char *contextName);
 
 std::string readTextFileOrThrow(const std::filesystem::path& p);
 } // namespace xmlutils
@@ -0,0 +1,137 @@
+#include "parser/xml_pull_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+bool isNameEnd(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>';
+}
+
+bool startsWith(const char *p, const char *end, std::string_view token) {
+  return static_cast<size_t>(end - p) >= token.size() && std::memcmp(p, token.data(), token.size()) == 0;
+}
+
+} // namespace
+
+bool XmlPullReader::fail(const std::string &message) {
+  if (error_.empty())
+    error_ = message + " at line " + std::to_string(line_) + ".";
+  pos_ = end_;
+  return false;
+}
+
+bool XmlPullReader::skipPast(std::string_view token) {
+  // memchr for the first character, the scene files are mostly tags
+  const char *found = pos_;
+  for (;;) {
+    found = static_cast<const char *>(std::memchr(found, token[0], static_cast<size_t>(end_ - found)));
+    if (!found || startsWith(found, end_, token))
+      break;
+    ++found;
+  }
+  if (!found)
+    found = end_;
+  line_ += static_cast<int>(std::count(pos_, found, '\n'));
+  if (found == end_) {
+    pos_ = end_;
+    return false;
+  }
+  pos_ = found + token.size();
+  return true;
+}
+
+bool XmlPullReader::nextChild(Element &out) {
+  if (enteredEmpty_) {
+    enteredEmpty_ = false;
+    open_.pop_back();
+    return false;
+  }
+  while (!failed()) {
+    // text between tags is ignored
+    if (!skipPast("<")) {
+      if (!open_.empty())
+        return fail("Missing end tag of <" + std::string(open_.back()) + ">");
+      return false;
+    }
+    const char *tag = pos_ - 1;
+
+    if (startsWith(pos_, end_, "!--")) {
+      if (!skipPast("-->"))
+        return fail("Unterminated comment");
+    } else if (startsWith(pos_, end_, "![CDATA[")) {
+      if (!skipPast("]]>"))
+        return fail("Unterminated CDATA section");
+    } else if (startsWith(pos_, end_, "?")) {
+      if (!skipPast("?>"))
+        return fail("Unterminated processing instruction");
+    } else if (startsWith(pos_, end_, "!")) {
+      // DOCTYPE, an internal subset in [] may contain '>'
+      int brackets = 0;
+      for (; pos_ < end_ && (*pos_ != '>' || brackets > 0); ++pos_) {
+        brackets += *pos_ == '[' ? 1 : *pos_ == ']' ? -1 : 0;
+        line_ += *pos_ == '\n' ? 1 : 0;
+      }
+      if (pos_ == end_)
+        return fail("Unterminated declaration");
+      ++pos_;
+    } else if (startsWith(pos_, end_, "/")) {
+      const char *name = pos_ + 1;
+      const char *nameEnd = name;
+      while (nameEnd < end_ && !isNameEnd(*nameEnd))
+        ++nameEnd;
+      const std::string_view closing(name, static_cast<size_t>(nameEnd - name));
+      if (open_.empty() || open_.back() != closing)
+        return fail("Unexpected end tag </" + std::string(closing) + ">");
+      open_.pop_back();
+      if (!skipPast(">"))
+        return fail("Unterminated end tag");
+      return false;
+    } else {
+      const char *name = pos_;
+      while (pos_ < end_ && !isNameEnd(*pos_))
+        ++pos_;
+      if (pos_ == name)
+        return fail("Malformed start tag");
+      out.name = std::string_view(name, static_cast<size_t>(pos_ - name));
+      out.begin = tag;
+      out.line = line_;
+      // '>' inside quoted attribute values does not end the tag
+      char quote = 0;
+      for (; pos_ < end_ && (quote || *pos_ != '>'); ++pos_) {
+        if (quote ? *pos_ == quote : (*pos_ == '"' || *pos_ == '\''))
+          quote = quote ? 0 : *pos_;
+        line_ += *pos_ == '\n' ? 1 : 0;
+      }
+      if (pos_ == end_)
+        return fail("Unterminated start tag <" + std::string(out.name) + ">");
+      out.selfClosing = pos_[-1] == '/';
+      out.startTagEnd = ++pos_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void XmlPullReader::enter(const Element &e) {
+  if (open_.size() >= kMaxDepth) {
+    line_ = e.line;
+    fail("Elements nested deeper than " + std::to_string(kMaxDepth));
+    return;
+  }
+  open_.push_back(e.name);
+  enteredEmpty_ = e.selfClosing;
+}
+
+const char *XmlPullReader::skip(const Element &e) {
+  // iterative, nextChild() leaves an element by returning false at its end tag
+  const size_t depth = open_.size();
+  enter(e);
+  Element child;
+  while (open_.size() > depth && !failed()) {
+    if (nextChild(child))
+      enter(child);
+  }
+  return pos_;
+}
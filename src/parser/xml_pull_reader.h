@@ -0,0 +1,58 @@
+#ifndef XML_PULL_READER_H
+#define XML_PULL_READER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Forward-only walk over the elements of an XML text without building a DOM. It only finds
+// element boundaries (start tag, end tag, nesting); attributes, entities and text are left
+// to whoever parses the returned spans, so elements can be handed to tinyxml2 one by one.
+// Comments, processing instructions, CDATA sections and DOCTYPE declarations are skipped.
+// Nesting is limited to kMaxDepth elements like in tinyxml2, deeper input is an error.
+class XmlPullReader {
+public:
+  static constexpr size_t kMaxDepth = 500;
+
+  struct Element {
+    std::string_view name;
+    const char *begin;       // '<' of the start tag
+    const char *startTagEnd; // one past the '>' of the start tag
+    bool selfClosing;
+    int line;                // line of the start tag, 1-based
+  };
+
+  XmlPullReader(const char *begin, const char *end) : pos_(begin), end_(end) {}
+
+  // Next child element of the element entered last (at first: top level elements). False at
+  // the end tag of that element, which is consumed, at the end of the input or on an error.
+  bool nextChild(Element &out);
+  // Continue with the children of 'e', which must be the element just returned by nextChild().
+  // Fails if that exceeds kMaxDepth.
+  void enter(const Element &e);
+  // Skips 'e' (just returned by nextChild()) including its end tag, returns one past its end
+  const char *skip(const Element &e);
+
+  bool failed() const {
+    return !error_.empty();
+  }
+  const std::string &error() const {
+    return error_;
+  }
+
+private:
+  // advances to 'token' and past it, counting lines; false if it does not occur
+  bool skipPast(std::string_view token);
+  bool fail(const std::string &message);
+
+  const char *pos_;
+  const char *end_;
+  int line_ = 1;
+  // names of the entered elements, to check the end tags
+  std::vector<std::string_view> open_;
+  bool enteredEmpty_ = false;
+  std::string error_;
+};
+
+#endif
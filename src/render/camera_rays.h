@@ -0,0 +1,61 @@
+#ifndef RENDER_CAMERA_RAYS_H
+#define RENDER_CAMERA_RAYS_H
+
+#include <cmath>
+
+#include "math/ray.h"
+#include "scene/camera.h"
+
+// Offset of sample index within its pixel. Sample 0 is the pixel center, further samples
+// follow the R2 low discrepancy sequence.
+inline void sampleOffset(int index, float &ox, float &oy) {
+  constexpr double kA1 = 0.7548776662466927; // 1 / plastic number
+  constexpr double kA2 = 0.5698402909980532; // 1 / plastic number^2
+  ox = static_cast<float>(std::fmod(0.5 + kA1 * index, 1.0));
+  oy = static_cast<float>(std::fmod(0.5 + kA2 * index, 1.0));
+}
+
+// Precomputed pinhole camera basis for primary ray generation
+class CameraRays {
+public:
+  explicit CameraRays(const Camera &camera) : origin_(camera.position()) {
+    const float w = static_cast<float>(camera.resHorizontal());
+    const float h = static_cast<float>(camera.resVertical());
+    const float tanHalf = std::tan(camera.horizontalFovHalfAngle() * 3.14159265358979323846f / 180.f);
+
+    forward_ = (camera.lookat() - camera.position()).normalized();
+    right_ = cross(forward_, camera.up()).normalized();
+    const Vec3 up = cross(right_, forward_);
+
+    // map pixel coordinates directly onto the image plane at distance 1
+    pixelRight_ = right_ * (2.f * tanHalf / w);
+    pixelDown_ = up * (-2.f * tanHalf / w);
+    topLeft_ = forward_ - right_ * tanHalf + up * (tanHalf * h / w);
+    pixelSpread_ = std::atan(2.f * tanHalf / w);
+  }
+
+  // angle subtended by one pixel at the image center, the spread of a ray cone per pixel
+  float pixelSpreadAngle() const {
+    return pixelSpread_;
+  }
+
+  // (px, py) in pixel units, (0, 0) is the top left corner of the image
+  Ray generate(float px, float py) const {
+    Ray r;
+    r.origin = origin_;
+    r.direction = (topLeft_ + pixelRight_ * px + pixelDown_ * py).normalized();
+    r.tMin = 0.f;
+    return r;
+  }
+
+private:
+  Vec3 origin_;
+  Vec3 forward_;
+  Vec3 right_;
+  Vec3 pixelRight_;
+  Vec3 pixelDown_;
+  Vec3 topLeft_;
+  float pixelSpread_;
+};
+
+#endif
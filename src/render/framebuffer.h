@@ -0,0 +1,30 @@
+#ifndef RENDER_FRAMEBUFFER_H
+#define RENDER_FRAMEBUFFER_H
+
+#include <vector>
+
+#include "math/color.h"
+
+// Linear float RGB image, row 0 is the top row
+class Framebuffer {
+public:
+  Framebuffer(int width, int height) : width_(width), height_(height), pixels_(static_cast<size_t>(width) * height) {}
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  Color &at(int x, int y) { return pixels_[static_cast<size_t>(y) * width_ + x]; }
+  const Color &at(int x, int y) const { return pixels_[static_cast<size_t>(y) * width_ + x]; }
+
+  // linear index y * width + x
+  Color &pixel(size_t index) { return pixels_[index]; }
+
+  const std::vector<Color> &pixels() const { return pixels_; }
+
+private:
+  int width_;
+  int height_;
+  std::vector<Color> pixels_;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "render/light_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t kMaxLeafSize = 8;
+constexpr float kPi = 3.14159265358979323846f;
+
+Vec3 lightPosition(const Light &light) {
+  return light.type() == LightType::SPOT ? static_cast<const SpotLight &>(light).position()
+                                         : static_cast<const PointLight &>(light).position();
+}
+
+float angleBetween(const Vec3 &a, const Vec3 &b) {
+  return std::acos(std::clamp(dot(a, b), -1.f, 1.f));
+}
+
+} // namespace
+
+LightBVH::LightBVH(const Scene &scene, float minPower) : minPower_(minPower) {
+  const auto &lights = scene.lights();
+  for (uint32_t i = 0; i < lights.size(); ++i) {
+    const Light *light = lights[i].get();
+    if (light->type() == LightType::POINT || light->type() == LightType::SPOT)
+      lights_.push_back({light, i});
+    else if (light->type() == LightType::PARALLEL)
+      unbounded_.push_back({light, i});
+  }
+  if (lights_.empty())
+    return;
+
+  // point lights first: build() keeps them in their own subtree so spot subtrees keep tight cones
+  std::stable_partition(lights_.begin(), lights_.end(), [](const Entry &e) { return e.light->type() == LightType::POINT; });
+
+  nodes_.reserve(2 * lights_.size());
+  build(0, static_cast<uint32_t>(lights_.size()));
+}
+
+// Median split on the largest axis of the light positions, returns the index of the created node
+uint32_t LightBVH::build(uint32_t begin, uint32_t end) {
+  const uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+  nodes_.emplace_back();
+
+  LightNode node;
+  Vec3 axisSum{};
+  float thetaE = 0.f;
+  bool omni = false;
+  for (uint32_t i = begin; i < end; ++i) {
+    const Light &light = *lights_[i].light;
+    node.bounds.expand(lightPosition(light));
+    node.power += std::max({light.color().x, light.color().y, light.color().z});
+    if (light.type() == LightType::SPOT) {
+      const SpotLight &spot = static_cast<const SpotLight &>(light);
+      axisSum += spot.direction();
+      thetaE = std::max(thetaE, spot.alpha2() * kPi / 180.f);
+    } else {
+      omni = true;
+    }
+  }
+  node.lights = end - begin;
+
+  // orientation cone around the mean spot axis, point lights emit in all directions
+  const float axisLength = axisSum.length();
+  if (!omni && axisLength >= 1e-6f) {
+    node.axis = axisSum / axisLength;
+    float thetaO = 0.f;
+    for (uint32_t i = begin; i < end; ++i)
+      thetaO = std::max(thetaO, angleBetween(node.axis, static_cast<const SpotLight &>(*lights_[i].light).direction()));
+    if (thetaO + thetaE < kPi) {
+      node.cone = 1;
+      node.cosThetaO = std::cos(thetaO);
+      node.sinThetaO = std::sin(thetaO);
+      node.cosThetaE = std::cos(thetaE);
+    }
+  }
+
+  const uint32_t count = end - begin;
+  if (count <= kMaxLeafSize) {
+    node.offset = begin;
+    node.count = static_cast<uint16_t>(count);
+    nodes_[nodeIndex] = node;
+    return nodeIndex;
+  }
+
+  // only the root mixes both types (partitioned in the constructor), split it at the boundary;
+  // otherwise median split, even if all lights share one position so leaves stay small
+  uint32_t mid = static_cast<uint32_t>(
+      std::partition_point(lights_.begin() + begin, lights_.begin() + end,
+                           [](const Entry &e) { return e.light->type() == LightType::POINT; }) -
+      lights_.begin());
+  if (mid == begin || mid == end) {
+    const int axis = node.bounds.largestAxis();
+    mid = begin + count / 2;
+    std::nth_element(lights_.begin() + begin, lights_.begin() + mid, lights_.begin() + end,
+                     [axis](const Entry &a, const Entry &b) {
+                       return axisValue(lightPosition(*a.light), axis) < axisValue(lightPosition(*b.light), axis);
+                     });
+  }
+
+  build(begin, mid);
+  node.offset = build(mid, end);
+  nodes_[nodeIndex] = node;
+  return nodeIndex;
+}
+
+bool LightBVH::mayLight(const LightNode &node, const Vec3 &p, const Vec3 &n) const {
+  if (node.power < minPower_)
+    return false;
+
+  // all lights behind the tangent plane: max over the box of dot(n, x - p) <= 0
+  const Vec3 center = node.bounds.centroid();
+  const Vec3 half = node.bounds.extent() * 0.5f;
+  const float maxFacing = dot(n, center - p) + std::fabs(n.x) * half.x + std::fabs(n.y) * half.y + std::fabs(n.z) * half.z;
+  if (maxFacing <= 0.f)
+    return false;
+
+  if (!node.cone)
+    return true;
+
+  // p outside every spot cone: the angle between the cone axis and the direction to p, reduced
+  // by the spread of the axes and by the angle the box subtends from p, is at least alpha2.
+  // Evaluated on cosines; a difference that would be negative clamps to an angle of 0.
+  const Vec3 toPoint = p - center;
+  const float distSq = toPoint.lengthSquared();
+  const float radiusSq = half.lengthSquared();
+  if (distSq <= radiusSq)
+    return true;
+  const float cosW = dot(node.axis, toPoint) / std::sqrt(distSq);
+  const float sinW = std::sqrt(std::max(0.f, 1.f - cosW * cosW));
+  if (cosW > node.cosThetaO)
+    return true;
+  const float cosX = cosW * node.cosThetaO + sinW * node.sinThetaO;
+  const float sinX = sinW * node.cosThetaO - cosW * node.sinThetaO;
+  const float sinU = std::sqrt(radiusSq / distSq);
+  const float cosU = std::sqrt(1.f - sinU * sinU);
+  if (cosX > cosU)
+    return true;
+  return cosX * cosU + sinX * sinU > node.cosThetaE;
+}
@@ -0,0 +1,80 @@
+#ifndef RENDER_LIGHT_BVH_H
+#define RENDER_LIGHT_BVH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "math/bounds3.h"
+#include "scene/scene.h"
+
+struct LightNode {
+  Bounds3 bounds;          // positions of the lights in the subtree
+  Vec3 axis{0.f, 0.f, 1.f};
+  float cosThetaO = 1.f;   // spread of the spot axes around 'axis'
+  float sinThetaO = 0.f;
+  float cosThetaE = 1.f;   // largest spot outer angle (alpha2) in the subtree
+  float power = 0.f;       // sum of the largest color channel of all lights in the subtree
+  uint32_t lights = 0;     // number of lights in the subtree
+  uint32_t offset = 0;     // leaf: first light, interior: index of the second child (first child is this + 1)
+  uint16_t count = 0;      // number of lights, 0 for interior nodes
+  uint8_t cone = 0;        // 1 if the orientation cone can exclude points (only spots, thetaO + thetaE < pi)
+};
+
+// Hierarchy over the point and spot lights of a scene (bounds + orientation cones, Conty
+// Estevez and Kulla 2018). Subtrees that lie completely behind the tangent plane of a
+// shading point or whose spot cones cannot reach it are skipped as a whole, so a shading
+// point only visits the lights that can actually contribute. Parallel lights are unbounded
+// and always visited.
+class LightBVH {
+public:
+  // minPower > 0 also skips subtrees whose summed intensity (largest color channel) is
+  // below it, trading a bounded error for fewer shadow rays
+  LightBVH(const Scene &scene, float minPower);
+
+  // Calls fn(light, index) for every light that may light p from the side n points to, index
+  // is the position of the light in Scene::lights(). 'culled' is increased by the number of lights skipped
+  template <class Fn>
+  void forEachLight(const Vec3 &p, const Vec3 &n, uint64_t &culled, Fn &&fn) const {
+    for (const Entry &e : unbounded_)
+      fn(*e.light, e.index);
+    if (nodes_.empty())
+      return;
+
+    uint32_t stack[kStackSize];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+      const uint32_t index = stack[--sp];
+      const LightNode &node = nodes_[index];
+      if (!mayLight(node, p, n)) {
+        culled += node.lights;
+        continue;
+      }
+      if (node.count > 0) {
+        for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+          fn(*lights_[i].light, lights_[i].index);
+      } else {
+        stack[sp++] = node.offset;
+        stack[sp++] = index + 1;
+      }
+    }
+  }
+
+private:
+  static constexpr int kStackSize = 64;
+
+  struct Entry {
+    const Light *light;
+    uint32_t index;
+  };
+
+  bool mayLight(const LightNode &node, const Vec3 &p, const Vec3 &n) const;
+  uint32_t build(uint32_t begin, uint32_t end);
+
+  std::vector<LightNode> nodes_;
+  std::vector<Entry> lights_;    // point and spot lights in leaf order
+  std::vector<Entry> unbounded_; // parallel lights
+  float minPower_;
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "render/parallel_shadow_map.h"
+#include "scene/surfaces/mesh.h"
+#include "scene/surfaces/sphere.h"
+#include "util/task_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr float kInf = std::numeric_limits<float>::infinity();
+// texel rows per build task
+constexpr int kBandRows = 16;
+
+} // namespace
+
+// A primitive in light space (s, t, depth)
+struct ParallelShadowMap::Prim {
+  enum Kind { TRIANGLE, SPHERE, BOX } kind;
+  Vec3 a, b, c; // triangle vertices; sphere: a = center; box: a = min, b = max
+  float radius = 0.f;
+
+  void extent(float &sMin, float &sMax, float &tMin, float &tMax) const {
+    switch (kind) {
+    case TRIANGLE:
+      sMin = std::min({a.x, b.x, c.x});
+      sMax = std::max({a.x, b.x, c.x});
+      tMin = std::min({a.y, b.y, c.y});
+      tMax = std::max({a.y, b.y, c.y});
+      break;
+    case SPHERE:
+      sMin = a.x - radius;
+      sMax = a.x + radius;
+      tMin = a.y - radius;
+      tMax = a.y + radius;
+      break;
+    default: // BOX
+      sMin = a.x;
+      sMax = b.x;
+      tMin = a.y;
+      tMax = b.y;
+      break;
+    }
+  }
+};
+
+ParallelShadowMap::ParallelShadowMap(const Scene &scene, const Vec3 &direction, int resolution)
+    : d_(direction.normalized()), resolution_(std::max(1, resolution)) {
+  const Vec3 helper = std::fabs(d_.x) < 0.9f ? Vec3{1.f, 0.f, 0.f} : Vec3{0.f, 1.f, 0.f};
+  u_ = cross(d_, helper).normalized();
+  v_ = cross(d_, u_);
+
+  std::vector<Prim> prims;
+  Bounds3 world;
+  for (const auto &surface : scene.surfaces()) {
+    world.expand(surface->worldBounds());
+    if (surface->type() == SurfaceType::MESH) {
+      for (const TrianglePrimitive &tri : static_cast<const Mesh &>(*surface).triangles())
+        prims.push_back({Prim::TRIANGLE, toLight(tri.v0), toLight(tri.v1), toLight(tri.v2)});
+      continue;
+    }
+    const Sphere *sphere = surface->type() == SurfaceType::SPHERE ? static_cast<const Sphere *>(surface.get()) : nullptr;
+    if (sphere && sphere->transform().isIdentity()) {
+      Prim p{Prim::SPHERE, toLight(sphere->centerPosition()), {}, {}};
+      p.radius = sphere->radius();
+      prims.push_back(p);
+      continue;
+    }
+    // anything else only contributes its bounds to the lower depth bound
+    Bounds3 box;
+    const Bounds3 b = surface->worldBounds();
+    for (int i = 0; i < 8; ++i)
+      box.expand(toLight({(i & 1) ? b.max.x : b.min.x, (i & 2) ? b.max.y : b.min.y, (i & 4) ? b.max.z : b.min.z}));
+    prims.push_back({Prim::BOX, box.min, box.max, {}});
+  }
+  if (world.empty())
+    return; // no geometry: every origin is lit
+
+  // square texels over the projection of the scene bounds
+  Bounds3 projected;
+  float maxCoord = 1.f;
+  for (int i = 0; i < 8; ++i) {
+    const Vec3 corner{(i & 1) ? world.max.x : world.min.x, (i & 2) ? world.max.y : world.min.y, (i & 4) ? world.max.z : world.min.z};
+    projected.expand(toLight(corner));
+    maxCoord = std::max({maxCoord, std::fabs(corner.x), std::fabs(corner.y), std::fabs(corner.z)});
+  }
+  const Vec3 extent = projected.extent();
+  texelSize_ = std::max({extent.x, extent.y, 1e-6f}) * (1.f + 1e-4f) / static_cast<float>(resolution_);
+  s0_ = projected.min.x - texelSize_ * 1e-3f;
+  t0_ = projected.min.y - texelSize_ * 1e-3f;
+  // float error of depths and plane evaluations at the magnitude of the scene coordinates
+  margin_ = 4e-6f * maxCoord;
+
+  Texel empty;
+  empty.planeBound = kInf;
+  empty.restDepth = kInf;
+  empty.solidDepth = kInf;
+  texels_.assign(static_cast<size_t>(resolution_) * resolution_, empty);
+
+  // bin primitives into bands of rows, the bands are rasterized in parallel
+  const int bandCount = (resolution_ + kBandRows - 1) / kBandRows;
+  std::vector<std::vector<uint32_t>> bands(bandCount);
+  for (uint32_t i = 0; i < prims.size(); ++i) {
+    float sMin, sMax, tMin, tMax;
+    prims[i].extent(sMin, sMax, tMin, tMax);
+    const int row0 = std::clamp(static_cast<int>(std::floor((tMin - t0_) / texelSize_)), 0, resolution_ - 1);
+    const int row1 = std::clamp(static_cast<int>(std::floor((tMax - t0_) / texelSize_)), 0, resolution_ - 1);
+    for (int band = row0 / kBandRows; band <= row1 / kBandRows; ++band)
+      bands[band].push_back(i);
+  }
+  parallelFor(0, bands.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t band = begin; band < end; ++band) {
+      const int row0 = static_cast<int>(band) * kBandRows;
+      const int row1 = std::min(resolution_, row0 + kBandRows);
+      for (uint32_t i : bands[band])
+        rasterize(prims[i], row0, row1);
+    }
+  });
+}
+
+// Updates the texels of rows [row0, row1) that the primitive touches
+void ParallelShadowMap::rasterize(const Prim &prim, int row0, int row1) {
+  float sMin, sMax, tMin, tMax;
+  prim.extent(sMin, sMax, tMin, tMax);
+  const int x0 = std::clamp(static_cast<int>(std::floor((sMin - s0_) / texelSize_)), 0, resolution_ - 1);
+  const int x1 = std::clamp(static_cast<int>(std::floor((sMax - s0_) / texelSize_)), 0, resolution_ - 1);
+  const int y0 = std::max(row0, std::clamp(static_cast<int>(std::floor((tMin - t0_) / texelSize_)), 0, resolution_ - 1));
+  const int y1 = std::min(row1 - 1, std::clamp(static_cast<int>(std::floor((tMax - t0_) / texelSize_)), 0, resolution_ - 1));
+
+  // coverage is tested on the texel grown by a little, so a ray anywhere in the texel is strictly inside
+  const float grow = texelSize_ * 1e-3f;
+  const float mergeTolerance = texelSize_ * 1e-3f;
+
+  if (prim.kind == Prim::BOX) {
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x) {
+        Texel &tx = texels_[static_cast<size_t>(y) * resolution_ + x];
+        tx.restDepth = std::min(tx.restDepth, prim.a.z);
+      }
+    return;
+  }
+
+  if (prim.kind == Prim::SPHERE) {
+    const float r2 = prim.radius * prim.radius;
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        Texel &tx = texels_[static_cast<size_t>(y) * resolution_ + x];
+        tx.restDepth = std::min(tx.restDepth, prim.a.z - prim.radius);
+        // farthest texel corner from the center: the front surface is deepest there
+        const float cs = s0_ + static_cast<float>(x) * texelSize_, ct = t0_ + static_cast<float>(y) * texelSize_;
+        const float ds = std::max(std::fabs(cs - grow - prim.a.x), std::fabs(cs + texelSize_ + grow - prim.a.x));
+        const float dt = std::max(std::fabs(ct - grow - prim.a.y), std::fabs(ct + texelSize_ + grow - prim.a.y));
+        const float rho2 = ds * ds + dt * dt;
+        if (rho2 < r2 * 0.999f)
+          tx.solidDepth = std::min(tx.solidDepth, prim.a.z - std::sqrt(r2 - rho2));
+      }
+    }
+    return;
+  }
+
+  // triangle: depth = planeS * s + planeT * t + planeC unless it is seen edge-on
+  const Vec3 n = cross(prim.b - prim.a, prim.c - prim.a);
+  const float minVertex = std::min({prim.a.z, prim.b.z, prim.c.z});
+  const bool planar = std::fabs(n.z) > 1e-6f * n.length();
+  const float planeS = planar ? -n.x / n.z : 0.f;
+  const float planeT = planar ? -n.y / n.z : 0.f;
+  const float planeC = planar ? prim.a.z + (n.x * prim.a.x + n.y * prim.a.y) / n.z : 0.f;
+  const float orientation = n.z > 0.f ? 1.f : -1.f;
+  auto inside = [&](float s, float t) {
+    auto edge = [&](const Vec3 &p, const Vec3 &q) {
+      return orientation * ((q.x - p.x) * (t - p.y) - (q.y - p.y) * (s - p.x)) > 0.f;
+    };
+    return edge(prim.a, prim.b) && edge(prim.b, prim.c) && edge(prim.c, prim.a);
+  };
+
+  for (int y = y0; y <= y1; ++y) {
+    const float ct0 = t0_ + static_cast<float>(y) * texelSize_, ct1 = ct0 + texelSize_;
+    for (int x = x0; x <= x1; ++x) {
+      Texel &tx = texels_[static_cast<size_t>(y) * resolution_ + x];
+      if (!planar) {
+        tx.restDepth = std::min(tx.restDepth, minVertex);
+        continue;
+      }
+      const float cs0 = s0_ + static_cast<float>(x) * texelSize_, cs1 = cs0 + texelSize_;
+      const float corners[4][2] = {{cs0, ct0}, {cs1, ct0}, {cs0, ct1}, {cs1, ct1}};
+      float fMin = kInf, fMax = -kInf;
+      for (const auto &c : corners) {
+        const float f = planeS * c[0] + planeT * c[1] + planeC;
+        fMin = std::min(fMin, f);
+        fMax = std::max(fMax, f);
+      }
+      const float bound = std::max(minVertex, fMin);
+
+      // solid: the grown texel lies completely inside the triangle
+      if (inside(cs0 - grow, ct0 - grow) && inside(cs1 + grow, ct0 - grow) && inside(cs0 - grow, ct1 + grow) &&
+          inside(cs1 + grow, ct1 + grow))
+        tx.solidDepth = std::min(tx.solidDepth, fMax + margin_ * (std::fabs(planeS) + std::fabs(planeT)));
+
+      if (tx.planeBound == kInf) {
+        tx.planeS = planeS;
+        tx.planeT = planeT;
+        tx.planeC = planeC;
+        tx.planeSlack = 0.f;
+        tx.planeBound = bound;
+        continue;
+      }
+      // nearly coplanar with the texel's plane: merge, the slack keeps the plane below both
+      float diffMin = kInf, diffMax = -kInf;
+      for (const auto &c : corners) {
+        const float diff = (tx.planeS * c[0] + tx.planeT * c[1] + tx.planeC) - (planeS * c[0] + planeT * c[1] + planeC);
+        diffMin = std::min(diffMin, diff);
+        diffMax = std::max(diffMax, diff);
+      }
+      if (std::max(std::fabs(diffMin), std::fabs(diffMax)) <= mergeTolerance) {
+        tx.planeSlack = std::max(tx.planeSlack, diffMax);
+        tx.planeBound = std::min(tx.planeBound, bound);
+      } else if (bound < tx.planeBound) {
+        // the nearest surface keeps the plane, the previous one becomes part of the rest
+        tx.restDepth = std::min(tx.restDepth, tx.planeBound);
+        tx.planeS = planeS;
+        tx.planeT = planeT;
+        tx.planeC = planeC;
+        tx.planeSlack = 0.f;
+        tx.planeBound = bound;
+      } else {
+        tx.restDepth = std::min(tx.restDepth, bound);
+      }
+    }
+  }
+}
+
+ParallelShadowMap::Visibility ParallelShadowMap::classify(const Vec3 &origin) const {
+  if (texels_.empty())
+    return Visibility::LIT;
+  const Vec3 q = toLight(origin);
+  const float fx = std::floor((q.x - s0_) / texelSize_), fy = std::floor((q.y - t0_) / texelSize_);
+  // outside the projection of the scene nothing can block the ray
+  if (fx < 0.f || fy < 0.f || fx >= static_cast<float>(resolution_) || fy >= static_cast<float>(resolution_))
+    return Visibility::LIT;
+
+  const Texel &tx = texels_[static_cast<size_t>(fy) * resolution_ + static_cast<size_t>(fx)];
+  if (q.z < tx.restDepth - margin_) {
+    if (tx.planeBound == kInf)
+      return Visibility::LIT;
+    // the evaluation error grows with the slope of the plane
+    const float planeMargin = margin_ * (1.f + std::fabs(tx.planeS) + std::fabs(tx.planeT));
+    if (q.z < tx.planeS * q.x + tx.planeT * q.y + tx.planeC - tx.planeSlack - planeMargin)
+      return Visibility::LIT;
+  }
+  if (q.z > tx.solidDepth + margin_)
+    return Visibility::SHADOWED;
+  return Visibility::UNKNOWN;
+}
+
+std::vector<std::unique_ptr<ParallelShadowMap>> buildParallelShadowMaps(const Scene &scene, int resolution) {
+  std::vector<std::unique_ptr<ParallelShadowMap>> maps(scene.lights().size());
+  if (resolution <= 0)
+    return maps;
+  for (size_t i = 0; i < maps.size(); ++i) {
+    const Light &light = *scene.lights()[i];
+    if (light.type() == LightType::PARALLEL)
+      maps[i] = std::make_unique<ParallelShadowMap>(scene, static_cast<const ParallelLight &>(light).direction(), resolution);
+  }
+  return maps;
+}
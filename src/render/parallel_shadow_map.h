@@ -0,0 +1,61 @@
+#ifndef RENDER_PARALLEL_SHADOW_MAP_H
+#define RENDER_PARALLEL_SHADOW_MAP_H
+
+#include <memory>
+#include <vector>
+
+#include "math/vec3.h"
+#include "scene/scene.h"
+
+// Conservative orthographic depth map along the direction of a parallel light. Decides for a
+// shadow ray origin whether the ray towards the light is certainly unblocked or certainly
+// blocked; only the remaining cases need a traced shadow ray.
+//
+// Every texel covers a column of the scene along the light direction and stores
+//  - the plane of the nearest triangle touching the column: an origin on the light side of
+//    it cannot hit any triangle of that plane (this keeps receivers from shadowing themselves),
+//  - a lower bound of the depth of all other geometry in the column,
+//  - the smallest far depth of a triangle or sphere that covers the whole texel: an origin
+//    behind it always hits it.
+// The map is built by rasterizing all primitives, in parallel over bands of texel rows.
+class ParallelShadowMap {
+public:
+  enum class Visibility { UNKNOWN, LIT, SHADOWED };
+
+  // direction: direction the light travels, resolution: texels per side
+  ParallelShadowMap(const Scene &scene, const Vec3 &direction, int resolution);
+
+  Visibility classify(const Vec3 &origin) const;
+
+  size_t memoryBytes() const {
+    return texels_.size() * sizeof(Texel);
+  }
+
+private:
+  struct Texel {
+    // nearest plane: depth = planeS * s + planeT * t + planeC, minus planeSlack for merged
+    // nearly coplanar triangles; no plane while planeBound is infinite
+    float planeS = 0.f, planeT = 0.f, planeC = 0.f, planeSlack = 0.f;
+    float planeBound;  // min depth of the plane over the texel, picks the nearest plane during the build
+    float restDepth;   // min depth of all other geometry in the column
+    float solidDepth;  // min over covering occluders of their max depth over the texel
+  };
+
+  struct Prim;
+
+  Vec3 toLight(const Vec3 &p) const {
+    return {dot(p, u_), dot(p, v_), dot(p, d_)};
+  }
+  void rasterize(const Prim &prim, int row0, int row1);
+
+  Vec3 d_, u_, v_;
+  float s0_ = 0.f, t0_ = 0.f, texelSize_ = 1.f;
+  float margin_ = 0.f;
+  int resolution_;
+  std::vector<Texel> texels_;
+};
+
+// One map per parallel light, indexed like Scene::lights() (null for other lights)
+std::vector<std::unique_ptr<ParallelShadowMap>> buildParallelShadowMaps(const Scene &scene, int resolution);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef RENDER_PHONG_BATCH_H
+#define RENDER_PHONG_BATCH_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "math/color.h"
+#include "math/fast_pow.h"
+#include "scene/surfaces/material.h"
+
+// Lights of one shading point that passed the facing/shadow tests, in SoA form so the Phong
+// terms of four lights are evaluated per SSE2 instruction
+struct PhongBatch {
+  static constexpr int kCapacity = 8;
+
+  alignas(16) float lx[kCapacity] = {};
+  alignas(16) float ly[kCapacity] = {};
+  alignas(16) float lz[kCapacity] = {};
+  alignas(16) float nDotL[kCapacity] = {};
+  alignas(16) float r[kCapacity] = {};
+  alignas(16) float g[kCapacity] = {};
+  alignas(16) float b[kCapacity] = {};
+  int size = 0;
+
+  bool full() const {
+    return size == kCapacity;
+  }
+
+  // l: unit direction towards the light, intensity: light color arriving at the point
+  void push(const Vec3 &l, float cosine, const Color &intensity) {
+    lx[size] = l.x;
+    ly[size] = l.y;
+    lz[size] = l.z;
+    nDotL[size] = cosine;
+    r[size] = intensity.x;
+    g[size] = intensity.y;
+    b[size] = intensity.z;
+    ++size;
+  }
+};
+
+// Diffuse + specular Phong term of every light in the batch, n and v face the viewer.
+// Writes the contribution of light i to outR/G/B[i]. The specular cosine uses
+// dot(reflect(-l, n), v) = 2 dot(n, l) dot(n, v) - dot(l, v).
+inline void evaluatePhongBatch(const PhongParams &phong, const Color &base, const Vec3 &n, const Vec3 &v,
+                               const PhongBatch &batch, bool fastPow, float *outR, float *outG, float *outB) {
+  const float nDotV = dot(n, v);
+#ifdef FAST_POW_SSE2
+  const __m128 vx = _mm_set1_ps(v.x), vy = _mm_set1_ps(v.y), vz = _mm_set1_ps(v.z);
+  const __m128 twoNDotV = _mm_set1_ps(2.f * nDotV);
+  const __m128 kd = _mm_set1_ps(phong.kDiffuse), ks = _mm_set1_ps(phong.kSpecular);
+  const __m128 exponent = _mm_set1_ps(phong.exponentShininess);
+  const __m128 baseR = _mm_set1_ps(base.x), baseG = _mm_set1_ps(base.y), baseB = _mm_set1_ps(base.z);
+  for (int i = 0; i < batch.size; i += 4) {
+    const __m128 cosine = _mm_load_ps(batch.nDotL + i);
+    const __m128 lDotV = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(batch.lx + i), vx), _mm_mul_ps(_mm_load_ps(batch.ly + i), vy)),
+                                    _mm_mul_ps(_mm_load_ps(batch.lz + i), vz));
+    const __m128 rDotV = _mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_mul_ps(cosine, twoNDotV), lDotV));
+    __m128 spec;
+    if (fastPow) {
+      spec = fastPow4(rDotV, exponent);
+    } else {
+      // scalar pow on the occupied lanes only
+      alignas(16) float lanes[4];
+      _mm_store_ps(lanes, rDotV);
+      for (int k = 0, used = std::min(4, batch.size - i); k < used; ++k)
+        lanes[k] = std::pow(lanes[k], phong.exponentShininess);
+      spec = _mm_load_ps(lanes);
+    }
+    const __m128 diffuse = _mm_mul_ps(kd, cosine);
+    const __m128 specular = _mm_mul_ps(ks, spec);
+    _mm_storeu_ps(outR + i, _mm_mul_ps(_mm_load_ps(batch.r + i), _mm_add_ps(_mm_mul_ps(baseR, diffuse), specular)));
+    _mm_storeu_ps(outG + i, _mm_mul_ps(_mm_load_ps(batch.g + i), _mm_add_ps(_mm_mul_ps(baseG, diffuse), specular)));
+    _mm_storeu_ps(outB + i, _mm_mul_ps(_mm_load_ps(batch.b + i), _mm_add_ps(_mm_mul_ps(baseB, diffuse), specular)));
+  }
+#else
+  for (int i = 0; i < batch.size; ++i) {
+    const float lDotV = batch.lx[i] * v.x + batch.ly[i] * v.y + batch.lz[i] * v.z;
+    const float rDotV = std::max(0.f, 2.f * batch.nDotL[i] * nDotV - lDotV);
+    const float spec = fastPow ? ::fastPow(rDotV, phong.exponentShininess) : std::pow(rDotV, phong.exponentShininess);
+    const float diffuse = phong.kDiffuse * batch.nDotL[i];
+    const float specular = phong.kSpecular * spec;
+    outR[i] = batch.r[i] * (base.x * diffuse + specular);
+    outG[i] = batch.g[i] * (base.y * diffuse + specular);
+    outB[i] = batch.b[i] * (base.z * diffuse + specular);
+  }
+#endif
+}
+
+// Sum of the Phong terms of all lights in the batch
+inline Color sumPhongBatch(const PhongParams &phong, const Color &base, const Vec3 &n, const Vec3 &v,
+                           const PhongBatch &batch, bool fastPow) {
+  // rounded up to whole SIMD groups, the extra lanes are ignored
+  float outR[PhongBatch::kCapacity], outG[PhongBatch::kCapacity], outB[PhongBatch::kCapacity];
+  evaluatePhongBatch(phong, base, n, v, batch, fastPow, outR, outG, outB);
+  Color sum{};
+  for (int i = 0; i < batch.size; ++i)
+    sum += Color{outR[i], outG[i], outB[i]};
+  return sum;
+}
+
+#endif
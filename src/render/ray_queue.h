@@ -0,0 +1,159 @@
+#ifndef RENDER_RAY_QUEUE_H
+#define RENDER_RAY_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "math/color.h"
+#include "math/ray.h"
+#include "scene/surfaces/hit.h"
+
+// Structure-of-arrays ray batch for the wavefront renderer. Every stage streams over
+// contiguous per-component arrays instead of chasing per-ray structs.
+struct RayQueue {
+  std::vector<float> ox, oy, oz;
+  std::vector<float> dx, dy, dz;
+  std::vector<float> throughput;
+  std::vector<uint32_t> pixel;
+  std::vector<uint16_t> depth;
+  std::vector<float> coneWidth; // ray cone width at the origin
+  float tMin = 0.f; // shared by all rays of one generation
+
+  size_t size() const { return pixel.size(); }
+
+  void clear() {
+    ox.clear(); oy.clear(); oz.clear();
+    dx.clear(); dy.clear(); dz.clear();
+    throughput.clear();
+    pixel.clear();
+    depth.clear();
+    coneWidth.clear();
+  }
+
+  void reserve(size_t n) {
+    ox.reserve(n); oy.reserve(n); oz.reserve(n);
+    dx.reserve(n); dy.reserve(n); dz.reserve(n);
+    throughput.reserve(n);
+    pixel.reserve(n);
+    depth.reserve(n);
+    coneWidth.reserve(n);
+  }
+
+  void push(const Ray &r, float weight, uint32_t pixelIndex, int bounce, float width) {
+    ox.push_back(r.origin.x); oy.push_back(r.origin.y); oz.push_back(r.origin.z);
+    dx.push_back(r.direction.x); dy.push_back(r.direction.y); dz.push_back(r.direction.z);
+    throughput.push_back(weight);
+    pixel.push_back(pixelIndex);
+    depth.push_back(static_cast<uint16_t>(bounce));
+    coneWidth.push_back(width);
+  }
+
+  void append(const RayQueue &q) {
+    ox.insert(ox.end(), q.ox.begin(), q.ox.end());
+    oy.insert(oy.end(), q.oy.begin(), q.oy.end());
+    oz.insert(oz.end(), q.oz.begin(), q.oz.end());
+    dx.insert(dx.end(), q.dx.begin(), q.dx.end());
+    dy.insert(dy.end(), q.dy.begin(), q.dy.end());
+    dz.insert(dz.end(), q.dz.begin(), q.dz.end());
+    throughput.insert(throughput.end(), q.throughput.begin(), q.throughput.end());
+    pixel.insert(pixel.end(), q.pixel.begin(), q.pixel.end());
+    depth.insert(depth.end(), q.depth.begin(), q.depth.end());
+    coneWidth.insert(coneWidth.end(), q.coneWidth.begin(), q.coneWidth.end());
+  }
+
+  Ray ray(size_t i) const {
+    Ray r;
+    r.origin = {ox[i], oy[i], oz[i]};
+    r.direction = {dx[i], dy[i], dz[i]};
+    r.tMin = tMin;
+    return r;
+  }
+};
+
+// Closest-hit results, index aligned with the RayQueue they were computed for
+struct HitQueue {
+  std::vector<float> t, b1, b2;
+  std::vector<const Surface *> surface; // nullptr for misses
+  std::vector<uint32_t> primId;
+
+  void resize(size_t n) {
+    t.resize(n); b1.resize(n); b2.resize(n);
+    surface.resize(n);
+    primId.resize(n);
+  }
+
+  void set(size_t i, const Hit &h, bool found) {
+    t[i] = h.t;
+    b1[i] = h.b1;
+    b2[i] = h.b2;
+    surface[i] = found ? h.surface : nullptr;
+    primId[i] = h.primId;
+  }
+
+  Hit hit(size_t i) const {
+    Hit h;
+    h.t = t[i];
+    h.surface = surface[i];
+    h.primId = primId[i];
+    h.b1 = b1[i];
+    h.b2 = b2[i];
+    return h;
+  }
+};
+
+// Shadow rays with the (already weighted) contribution they add to their pixel when unoccluded
+struct ShadowQueue {
+  std::vector<float> ox, oy, oz;
+  std::vector<float> dx, dy, dz;
+  std::vector<float> tMax;
+  std::vector<float> r, g, b;
+  std::vector<uint32_t> pixel;
+  std::vector<uint32_t> light; // index into Scene::lights()
+
+  size_t size() const { return pixel.size(); }
+
+  void clear() {
+    ox.clear(); oy.clear(); oz.clear();
+    dx.clear(); dy.clear(); dz.clear();
+    tMax.clear();
+    r.clear(); g.clear(); b.clear();
+    pixel.clear();
+    light.clear();
+  }
+
+  void push(const Vec3 &origin, const Vec3 &dir, float maxDist, const Color &contribution, uint32_t pixelIndex,
+            uint32_t lightIndex) {
+    ox.push_back(origin.x); oy.push_back(origin.y); oz.push_back(origin.z);
+    dx.push_back(dir.x); dy.push_back(dir.y); dz.push_back(dir.z);
+    tMax.push_back(maxDist);
+    r.push_back(contribution.x); g.push_back(contribution.y); b.push_back(contribution.z);
+    pixel.push_back(pixelIndex);
+    light.push_back(lightIndex);
+  }
+
+  void append(const ShadowQueue &q) {
+    ox.insert(ox.end(), q.ox.begin(), q.ox.end());
+    oy.insert(oy.end(), q.oy.begin(), q.oy.end());
+    oz.insert(oz.end(), q.oz.begin(), q.oz.end());
+    dx.insert(dx.end(), q.dx.begin(), q.dx.end());
+    dy.insert(dy.end(), q.dy.begin(), q.dy.end());
+    dz.insert(dz.end(), q.dz.begin(), q.dz.end());
+    tMax.insert(tMax.end(), q.tMax.begin(), q.tMax.end());
+    r.insert(r.end(), q.r.begin(), q.r.end());
+    g.insert(g.end(), q.g.begin(), q.g.end());
+    b.insert(b.end(), q.b.begin(), q.b.end());
+    pixel.insert(pixel.end(), q.pixel.begin(), q.pixel.end());
+    light.insert(light.end(), q.light.begin(), q.light.end());
+  }
+
+  Ray ray(size_t i) const {
+    Ray ray;
+    ray.origin = {ox[i], oy[i], oz[i]};
+    ray.direction = {dx[i], dy[i], dz[i]};
+    ray.tMin = 0.f;
+    ray.tMax = tMax[i];
+    return ray;
+  }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "render/ray_sorting.h"
+
+#include <algorithm>
+
+namespace {
+
+// spreads the lower 10 bits of v so that there are two zero bits between each
+uint32_t expandBits10(uint32_t v) {
+  v &= 0x3ffu;
+  v = (v | (v << 16)) & 0x030000ffu;
+  v = (v | (v << 8)) & 0x0300f00fu;
+  v = (v | (v << 4)) & 0x030c30c3u;
+  v = (v | (v << 2)) & 0x09249249u;
+  return v;
+}
+
+uint32_t quantize(float v, float lo, float extent) {
+  if (extent <= 0.f)
+    return 0;
+  const float n = (v - lo) / extent;
+  return static_cast<uint32_t>(std::clamp(n, 0.f, 1.f) * 1023.f);
+}
+
+} // namespace
+
+uint64_t rayReorderKey(const Vec3 &origin, const Vec3 &direction, const Bounds3 &bounds) {
+  const uint64_t octant = (direction.x < 0.f ? 1u : 0u) | (direction.y < 0.f ? 2u : 0u) | (direction.z < 0.f ? 4u : 0u);
+
+  const Vec3 extent = bounds.extent();
+  const uint32_t x = quantize(origin.x, bounds.min.x, extent.x);
+  const uint32_t y = quantize(origin.y, bounds.min.y, extent.y);
+  const uint32_t z = quantize(origin.z, bounds.min.z, extent.z);
+  const uint64_t morton = (expandBits10(x) << 2) | (expandBits10(y) << 1) | expandBits10(z);
+
+  return (octant << 30) | morton;
+}
+
+void sortRays(RayQueue &rays, RayQueue &scratch, std::vector<std::pair<uint64_t, uint32_t>> &keys, const Bounds3 &bounds) {
+  const size_t n = rays.size();
+  keys.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = {rayReorderKey({rays.ox[i], rays.oy[i], rays.oz[i]}, {rays.dx[i], rays.dy[i], rays.dz[i]}, bounds),
+               static_cast<uint32_t>(i)};
+  }
+  std::sort(keys.begin(), keys.end());
+
+  scratch.clear();
+  scratch.reserve(n);
+  scratch.tMin = rays.tMin;
+  for (const auto &k : keys) {
+    const uint32_t i = k.second;
+    scratch.ox.push_back(rays.ox[i]); scratch.oy.push_back(rays.oy[i]); scratch.oz.push_back(rays.oz[i]);
+    scratch.dx.push_back(rays.dx[i]); scratch.dy.push_back(rays.dy[i]); scratch.dz.push_back(rays.dz[i]);
+    scratch.throughput.push_back(rays.throughput[i]);
+    scratch.pixel.push_back(rays.pixel[i]);
+    scratch.depth.push_back(rays.depth[i]);
+    scratch.coneWidth.push_back(rays.coneWidth[i]);
+  }
+  std::swap(rays, scratch);
+}
@@ -0,0 +1,19 @@
+#ifndef RENDER_RAY_SORTING_H
+#define RENDER_RAY_SORTING_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "math/bounds3.h"
+#include "render/ray_queue.h"
+
+// Sort key of a ray: direction octant in the top bits, then the Morton code of its origin
+// cell inside 'bounds' (10 bits per axis). Rays with equal keys start close to each other
+// and point into the same octant, so they tend to visit the same BVH nodes.
+uint64_t rayReorderKey(const Vec3 &origin, const Vec3 &direction, const Bounds3 &bounds);
+
+// Reorders 'rays' by rayReorderKey(). 'scratch' and 'keys' are reused buffers.
+void sortRays(RayQueue &rays, RayQueue &scratch, std::vector<std::pair<uint64_t, uint32_t>> &keys, const Bounds3 &bounds);
+
+#endif
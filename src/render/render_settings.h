@@ -0,0 +1,76 @@
+#ifndef RENDER_RENDER_SETTINGS_H
+#define RENDER_RENDER_SETTINGS_H
+
+#include <cstddef>
+#include <string>
+
+#include "scene/textures/texture.h"
+
+// Renderer options that are not part of the scene description (set from the command line)
+struct RenderSettings {
+  // secondary rays whose accumulated reflectance/transmittance product drops below this are not traced
+  float minThroughput = 1e-3f;
+
+  // the light hierarchy also skips groups of point/spot lights whose summed intensity (largest
+  // color channel) is below this, 0 = only skip lights that cannot contribute
+  float lightCullPower = 0.f;
+
+  // > 0: every parallel light gets a conservative depth map with this many texels per side that
+  // decides most shadow tests towards it without tracing a ray
+  int shadowMapResolution = 0;
+  // test the primitive that last blocked a shadow ray towards the same light (per thread) first
+  bool occluderCache = true;
+  // approximate pow() for the Phong specular exponent (about 1e-4 * exponent relative error)
+  bool fastPow = false;
+
+  // uniform supersampling, camera rays per pixel
+  int samplesPerPixel = 1;
+  // adaptive anti-aliasing: pixels whose color differs from a neighbour by more than
+  // aaThreshold (per channel) get more samples until their variance is low or aaMaxSamples is reached
+  bool adaptiveAA = false;
+  float aaThreshold = 0.1f;
+  int aaMaxSamples = 16;
+
+  // progressive rendering: samplesPerPixel are taken in passes of growing size and the
+  // intermediate average is written to the output file every snapshotInterval seconds
+  // (0 = never) and on SIGUSR1, checked between passes
+  bool progressive = false;
+  float snapshotInterval = 0.f;
+  // with a float output file (.pfm) also write an 8 bit PNG preview next to it
+  bool alsoPng = false;
+
+  // worker threads of the shared TaskScheduler including the main thread, 0 = all cores
+  unsigned threads = 0;
+  // bind worker i to CPU i
+  bool pinThreads = false;
+  // edge length of the square tiles distributed to the workers
+  int tileSize = 32;
+  // order tiles by cost estimated in a low resolution pre-pass and split expensive ones
+  bool adaptiveTiles = false;
+  // pre-pass samples one pixel out of every stride x stride block
+  int costPrepassStride = 8;
+  // adaptive splitting never produces tiles smaller than this
+  int minTileSize = 8;
+  // print per-tile timings after rendering
+  bool tileStats = false;
+
+  // after loading, also write the scene as a binary snapshot to this path (empty: don't);
+  // scene paths ending in .rtscene are loaded from such a snapshot
+  std::string saveScenePath;
+
+  // texel memory order of all textures of the scene
+  TextureLayout textureLayout = TextureLayout::TILED;
+  // > 0: textures are paged in from tile files under this memory budget instead of being
+  // held in memory completely; the tile files are written to textureCacheDir
+  size_t textureCacheMB = 0;
+  std::string textureCacheDir = "texture_cache";
+
+  // breadth-first rendering over SoA ray queues instead of per-pixel depth-first tracing
+  bool wavefront = false;
+  // number of pixels whose rays are in flight at once in wavefront mode
+  unsigned wavefrontBatchSize = 1u << 16;
+  // reorder secondary ray generations by direction octant and origin Morton code before traversal
+  bool sortRays = false;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef RENDER_RENDER_STATS_H
+#define RENDER_RENDER_STATS_H
+
+#include <cstdint>
+#include <ostream>
+
+struct RenderStats {
+  uint64_t primaryRays = 0;
+  uint64_t prepassRays = 0;   // cost estimation for adaptive tile scheduling
+  uint64_t aaRefinedPixels = 0;
+  uint64_t aaSamples = 0;     // camera rays added by adaptive anti-aliasing (included in primaryRays)
+  uint64_t secondaryRays = 0; // reflection + refraction
+  uint64_t shadowRays = 0;
+  uint64_t shadowRaysOccluded = 0;
+  uint64_t culledLights = 0; // lights skipped by the light hierarchy without a shadow ray
+  uint64_t occluderCacheHits = 0; // occluded shadow rays answered by the last occluder of their light
+  uint64_t shadowMapLit = 0;      // parallel light tests decided by the shadow map without a ray
+  uint64_t shadowMapShadowed = 0;
+  double shadowMapMs = 0.0;       // build time of the parallel light shadow maps
+  uint64_t culledRays = 0;   // secondary rays skipped because of low throughput
+
+  // wavefront mode only
+  uint64_t sortedRays = 0;
+  double raySortMs = 0.0;
+  double secondaryIntersectMs = 0.0; // closest-hit stage time for bounce >= 1
+};
+
+inline RenderStats &operator+=(RenderStats &a, const RenderStats &b) {
+  a.primaryRays += b.primaryRays;
+  a.prepassRays += b.prepassRays;
+  a.aaRefinedPixels += b.aaRefinedPixels;
+  a.aaSamples += b.aaSamples;
+  a.secondaryRays += b.secondaryRays;
+  a.shadowRays += b.shadowRays;
+  a.shadowRaysOccluded += b.shadowRaysOccluded;
+  a.culledLights += b.culledLights;
+  a.occluderCacheHits += b.occluderCacheHits;
+  a.shadowMapLit += b.shadowMapLit;
+  a.shadowMapShadowed += b.shadowMapShadowed;
+  a.shadowMapMs += b.shadowMapMs;
+  a.culledRays += b.culledRays;
+  a.sortedRays += b.sortedRays;
+  a.raySortMs += b.raySortMs;
+  a.secondaryIntersectMs += b.secondaryIntersectMs;
+  return a;
+}
+
+inline std::ostream &operator<<(std::ostream &os, const RenderStats &s) {
+  os << "RenderStats{primary=" << s.primaryRays
+     << ", prepass=" << s.prepassRays
+     << ", aa_refined_pixels=" << s.aaRefinedPixels
+     << ", aa_samples=" << s.aaSamples
+     << ", secondary=" << s.secondaryRays
+     << ", shadow=" << s.shadowRays
+     << ", shadow_occluded=" << s.shadowRaysOccluded
+     << ", culled_lights=" << s.culledLights
+     << ", occluder_cache_hits=" << s.occluderCacheHits
+     << ", occluder_hit_rate="
+     << (s.shadowRaysOccluded > 0 ? static_cast<double>(s.occluderCacheHits) / static_cast<double>(s.shadowRaysOccluded) : 0.0)
+     << ", shadow_map_lit=" << s.shadowMapLit
+     << ", shadow_map_shadowed=" << s.shadowMapShadowed
+     << ", shadow_map_ms=" << s.shadowMapMs
+     << ", culled=" << s.culledRays
+     << ", sorted=" << s.sortedRays
+     << ", sort_ms=" << s.raySortMs
+     << ", secondary_intersect_ms=" << s.secondaryIntersectMs
+     << "}";
+  return os;
+}
+
+#endif
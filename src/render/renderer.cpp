@@ -0,0 +1,408 @@
+#include "render/renderer.h"
+
+#include "render/phong_batch.h"
+#include "render/shading.h"
+#include "util/heap_guard.h"
+#include "util/task_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// A pending secondary ray with the product of the reflectance/transmittance factors along its
+// path and the width of its ray cone at the origin (for texture filtering)
+struct RayTask {
+  Ray ray;
+  float throughput;
+  int depth;
+  float coneWidth;
+};
+
+// samples added per refinement step of adaptive anti-aliasing
+constexpr int kAABatchSize = 4;
+
+float luminance(const Color &c) {
+  return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
+// Counts finished pixels per row and reports rows that became complete, in row order
+class RowTracker {
+public:
+  RowTracker(int width, int height, const Renderer::RowsCallback &onRows)
+      : width_(width), done_(static_cast<size_t>(height), 0), onRows_(onRows) {}
+
+  void tileDone(const Tile &tile) {
+    if (!onRows_)
+      return;
+    // finished rows are written to the image streams, which may allocate
+    HeapPermit streaming;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int y = tile.y0; y < tile.y1; ++y)
+      done_[y] += tile.x1 - tile.x0;
+    const int first = next_;
+    while (next_ < static_cast<int>(done_.size()) && done_[next_] == width_)
+      ++next_;
+    if (next_ > first)
+      onRows_(first, next_);
+  }
+
+private:
+  int width_;
+  std::vector<int> done_;
+  int next_ = 0;
+  const Renderer::RowsCallback &onRows_;
+  std::mutex mutex_;
+};
+
+} // namespace
+
+Renderer::Renderer(const Scene &scene, const RenderSettings &settings)
+    : scene_(scene), settings_(settings), cameraRays_(scene.camera()), intersector_(scene),
+      lights_(scene, settings.lightCullPower), occluders_(scene.lights().size()),
+      // samples of one pixel split its footprint
+      coneSpread_(cameraRays_.pixelSpreadAngle() / std::sqrt(static_cast<float>(std::max(1, settings.samplesPerPixel)))) {
+  const auto start = std::chrono::steady_clock::now();
+  shadowMaps_ = buildParallelShadowMaps(scene, settings.shadowMapResolution);
+  stats_.shadowMapMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::render(Framebuffer &fb, const RowsCallback &onRows) {
+  std::vector<Tile> tiles = makeTiles(fb.width(), fb.height(), settings_.tileSize);
+  TaskScheduler &scheduler = TaskScheduler::instance();
+
+  std::vector<double> estimates(tiles.size(), 0.0);
+  if (settings_.adaptiveTiles) {
+    const CostMap cost = estimateCost(fb);
+    tiles = planTiles(tiles, cost, scheduler.threadCount(), settings_.minTileSize);
+    estimates.resize(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i)
+      estimates[i] = cost.regionCost(tiles[i]);
+  }
+
+  // rows are final after the last pass over their tiles
+  RowTracker rows(fb.width(), fb.height(), onRows);
+
+  tileTimings_.clear();
+  frameStart_ = std::chrono::steady_clock::now();
+  runTiles(tiles, estimates, [&](const Tile &tile, RenderStats &stats) {
+    renderTile(fb, tile, stats);
+    if (!settings_.adaptiveAA)
+      rows.tileDone(tile);
+  });
+
+  if (settings_.adaptiveAA) {
+    // neighbours are compared on the unrefined image, refinement writes into fb
+    const Framebuffer base = fb;
+    runTiles(tiles, estimates, [&](const Tile &tile, RenderStats &stats) {
+      refineTile(fb, base, tile, stats);
+      rows.tileDone(tile);
+    });
+  }
+}
+
+void Renderer::renderProgressive(Framebuffer &fb, const PassCallback &onPass) {
+  std::vector<Tile> tiles = makeTiles(fb.width(), fb.height(), settings_.tileSize);
+  std::vector<double> estimates(tiles.size(), 0.0);
+  if (settings_.adaptiveTiles) {
+    const CostMap cost = estimateCost(fb);
+    tiles = planTiles(tiles, cost, TaskScheduler::instance().threadCount(), settings_.minTileSize);
+    estimates.resize(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i)
+      estimates[i] = cost.regionCost(tiles[i]);
+  }
+
+  Framebuffer sum(fb.width(), fb.height());
+  const int total = std::max(1, settings_.samplesPerPixel);
+  int done = 0;
+
+  tileTimings_.clear();
+  frameStart_ = std::chrono::steady_clock::now();
+  while (done < total) {
+    // each pass doubles the sample count so far, the first two passes take one sample
+    const int count = std::min(std::max(1, done), total - done);
+    runTiles(tiles, estimates, [&](const Tile &tile, RenderStats &stats) {
+      accumulateTile(sum, tile, done, count, stats);
+    });
+    done += count;
+
+    const float inv = 1.f / static_cast<float>(done);
+    parallelFor(0, static_cast<size_t>(fb.height()), 16, [&](size_t begin, size_t end) {
+      for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+        for (int x = 0; x < fb.width(); ++x)
+          fb.at(x, y) = sum.at(x, y) * inv;
+    });
+    onPass(fb, done);
+  }
+}
+
+void Renderer::runTiles(const std::vector<Tile> &tiles, const std::vector<double> &estimates,
+                        const std::function<void(const Tile &, RenderStats &)> &fn) {
+  auto sinceStart = [this] {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart_).count();
+  };
+
+  // every worker pulls the next tile in plan order, so expensive tiles start first
+  const size_t first = tileTimings_.size();
+  tileTimings_.resize(first + tiles.size());
+  std::atomic<size_t> next{0};
+
+  TaskScheduler &scheduler = TaskScheduler::instance();
+  TaskGroup group;
+  for (unsigned t = 0; t < scheduler.threadCount(); ++t) {
+    group.run([&] {
+      RenderStats local;
+      ScratchArena &scratch = scratch_.forCurrentThread();
+      for (size_t i = next++; i < tiles.size(); i = next++) {
+        TileTiming &timing = tileTimings_[first + i];
+        timing.tile = tiles[i];
+        timing.estimatedCost = estimates[i];
+        timing.thread = TaskScheduler::currentThreadIndex();
+        timing.startMs = sinceStart();
+        scratch.reset();
+        {
+          HeapGuard guard("a render tile");
+          fn(tiles[i], local);
+        }
+        timing.endMs = sinceStart();
+        // e.g. compression of the image rows this tile completed
+        scheduler.runPendingTask();
+      }
+      std::lock_guard<std::mutex> lock(statsMutex_);
+      stats_ += local;
+    });
+  }
+  group.wait();
+}
+
+CostMap Renderer::estimateCost(const Framebuffer &fb) {
+  const int stride = std::max(1, settings_.costPrepassStride);
+  CostMap cost(fb.width(), fb.height(), stride);
+
+  parallelFor(0, static_cast<size_t>(cost.gridHeight()), 1, [&](size_t begin, size_t end) {
+    RenderStats local;
+    for (size_t gy = begin; gy < end; ++gy) {
+      for (int gx = 0; gx < cost.gridWidth(); ++gx) {
+        const int x = std::min(fb.width() - 1, gx * stride + stride / 2);
+        const int y = std::min(fb.height() - 1, static_cast<int>(gy) * stride + stride / 2);
+        const auto start = std::chrono::steady_clock::now();
+        trace(cameraRays_.generate(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f), local);
+        cost.sample(gx, static_cast<int>(gy)) =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+    }
+    // pre-pass rays are reported separately from the frame's rays
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.prepassRays += static_cast<uint64_t>(end - begin) * cost.gridWidth();
+  });
+  return cost;
+}
+
+void Renderer::renderTile(Framebuffer &fb, const Tile &tile, RenderStats &stats) const {
+  const int spp = std::max(1, settings_.samplesPerPixel);
+  for (int y = tile.y0; y < tile.y1; ++y) {
+    for (int x = tile.x0; x < tile.x1; ++x) {
+      Color sum{};
+      for (int s = 0; s < spp; ++s)
+        sum += tracePixelSample(x, y, s, stats);
+      fb.at(x, y) = sum / static_cast<float>(spp);
+    }
+  }
+}
+
+void Renderer::accumulateTile(Framebuffer &sum, const Tile &tile, int firstSample, int count, RenderStats &stats) const {
+  for (int y = tile.y0; y < tile.y1; ++y)
+    for (int x = tile.x0; x < tile.x1; ++x)
+      for (int s = firstSample; s < firstSample + count; ++s)
+        sum.at(x, y) += tracePixelSample(x, y, s, stats);
+}
+
+// Adds samples to pixels that differ from a neighbour by more than the contrast threshold,
+// in batches until the estimated error of the pixel mean is small or the sample cap is reached
+void Renderer::refineTile(Framebuffer &fb, const Framebuffer &base, const Tile &tile, RenderStats &stats) const {
+  const int taken = std::max(1, settings_.samplesPerPixel);
+  const int maxSamples = std::max(taken, settings_.aaMaxSamples);
+  const float threshold = settings_.aaThreshold;
+
+  for (int y = tile.y0; y < tile.y1; ++y) {
+    for (int x = tile.x0; x < tile.x1; ++x) {
+      const Color &c = base.at(x, y);
+      float contrast = 0.f;
+      for (int ny = std::max(0, y - 1); ny <= std::min(base.height() - 1, y + 1); ++ny) {
+        for (int nx = std::max(0, x - 1); nx <= std::min(base.width() - 1, x + 1); ++nx) {
+          const Color d = base.at(nx, ny) - c;
+          contrast = std::max({contrast, std::fabs(d.x), std::fabs(d.y), std::fabs(d.z)});
+        }
+      }
+      if (contrast <= threshold)
+        continue;
+
+      ++stats.aaRefinedPixels;
+      // the existing mean counts as one observation for the variance estimate
+      Color sum = c * static_cast<float>(taken);
+      float lum = luminance(c);
+      float lumSum = lum;
+      float lumSqSum = lum * lum;
+      int observations = 1;
+      int count = taken;
+
+      while (count < maxSamples) {
+        const int batch = std::min(kAABatchSize, maxSamples - count);
+        for (int s = 0; s < batch; ++s) {
+          const Color sample = tracePixelSample(x, y, count + s, stats);
+          sum += sample;
+          lum = luminance(sample);
+          lumSum += lum;
+          lumSqSum += lum * lum;
+        }
+        count += batch;
+        observations += batch;
+        stats.aaSamples += static_cast<uint64_t>(batch);
+
+        // standard error of the mean luminance
+        const float mean = lumSum / observations;
+        const float variance = std::max(0.f, lumSqSum / observations - mean * mean);
+        if (std::sqrt(variance / observations) < threshold * 0.5f)
+          break;
+      }
+      fb.at(x, y) = sum / static_cast<float>(count);
+    }
+  }
+}
+
+Color Renderer::tracePixelSample(int x, int y, int sample, RenderStats &stats) const {
+  float ox, oy;
+  sampleOffset(sample, ox, oy);
+  ++stats.primaryRays;
+  return trace(cameraRays_.generate(static_cast<float>(x) + ox, static_cast<float>(y) + oy), stats);
+}
+
+Color Renderer::trace(const Ray &primary, RenderStats &stats) const {
+  const int maxBounces = scene_.camera().maxBounces();
+  // every bounce leaves at most one pending sibling on the stack, so it never holds more
+  // than maxBounces + 1 tasks and push() needs no overflow check
+  const int stackSize = maxBounces + 2;
+  ScratchArena &scratch = scratch_.forCurrentThread();
+  const ScratchArena::Marker marker = scratch.mark();
+  RayTask *stack = scratch.allocateArray<RayTask>(static_cast<size_t>(stackSize));
+  int sp = 0;
+  stack[sp++] = {primary, 1.f, 0, 0.f};
+
+  Color result{};
+
+  while (sp > 0) {
+    const RayTask task = stack[--sp];
+    Ray ray = task.ray;
+    Hit hit;
+    if (!intersector_.intersect(ray, hit)) {
+      result += scene_.backgroundColor() * task.throughput;
+      continue;
+    }
+
+    const SurfaceInteraction si = hit.surface->interaction(ray, hit);
+    const Material &m = *si.material;
+    // the cone keeps the pixel spread, curvature at reflections is ignored
+    const float coneWidth = task.coneWidth + coneSpread_ * hit.t;
+    const Color local = shade(ray, si, coneWidth, stats);
+
+    if (task.depth >= maxBounces) {
+      result += local * task.throughput;
+      continue;
+    }
+
+    const float kr = m.reflectance();
+    const float kt = m.transmittance();
+    result += local * (task.throughput * std::max(0.f, 1.f - kr - kt));
+
+    const bool entering = dot(ray.direction, si.normal) < 0.f;
+    const Vec3 n = entering ? si.normal : -si.normal;
+    const Vec3 reflected = reflect(ray.direction, n).normalized();
+
+    // prune branches that can no longer contribute visibly
+    auto push = [&](const Ray &next, float factor) {
+      if (factor <= 0.f)
+        return;
+      const float throughput = task.throughput * factor;
+      if (throughput < settings_.minThroughput) {
+        ++stats.culledRays;
+        return;
+      }
+      ++stats.secondaryRays;
+      stack[sp++] = {next, throughput, task.depth + 1, coneWidth};
+    };
+
+    push(Ray{si.point + n * kRayEpsilon, reflected}, kr);
+
+    if (kt > 0.f) {
+      const float eta = entering ? 1.f / m.ior() : m.ior();
+      Vec3 refracted;
+      if (refract(ray.direction, n, eta, refracted))
+        push(Ray{si.point - n * kRayEpsilon, refracted}, kt);
+      else
+        push(Ray{si.point + n * kRayEpsilon, reflected}, kt); // total internal reflection
+    }
+  }
+  scratch.rewind(marker);
+  return result;
+}
+
+Color Renderer::shade(const Ray &ray, const SurfaceInteraction &si, float coneWidth, RenderStats &stats) const {
+  const Material &m = *si.material;
+  const PhongParams &phong = m.phong();
+  const Color base = m.baseColor(si.uv.x, si.uv.y, textureLod(si, ray.direction, coneWidth));
+
+  const Vec3 v = -ray.direction;
+  const Vec3 n = dot(si.normal, v) < 0.f ? -si.normal : si.normal;
+
+  Color result{};
+  if (scene_.ambientLight())
+    result += scene_.ambientLight()->color() * base * phong.kAmbient;
+
+  // unoccluded lights are collected and their Phong terms evaluated a batch at a time
+  PhongBatch batch;
+  const Vec3 shadowOrigin = si.point + n * kRayEpsilon;
+  Occluder *lastOccluder = settings_.occluderCache ? occluders_.forCurrentThread() : nullptr;
+  lights_.forEachLight(si.point, n, stats.culledLights, [&](const Light &light, uint32_t index) {
+    Vec3 l;
+    float maxDist;
+    Color intensity;
+    if (!lightDirection(light, si.point, l, maxDist, intensity))
+      return;
+
+    // facing away from the light: no contribution, no shadow ray needed
+    const float nDotL = dot(n, l);
+    if (nDotL <= 0.f)
+      return;
+
+    // parallel lights with a shadow map may be decided without a shadow ray
+    const ParallelShadowMap *shadowMap = shadowMaps_[index].get();
+    const auto visibility = shadowMap ? shadowMap->classify(shadowOrigin) : ParallelShadowMap::Visibility::UNKNOWN;
+    if (visibility == ParallelShadowMap::Visibility::SHADOWED) {
+      ++stats.shadowMapShadowed;
+      return;
+    }
+    if (visibility == ParallelShadowMap::Visibility::LIT) {
+      ++stats.shadowMapLit;
+    } else {
+      ++stats.shadowRays;
+      const Ray shadowRay{shadowOrigin, l, 0.f, maxDist - kRayEpsilon};
+      bool cacheHit = false;
+      if (lastOccluder ? intersector_.occluded(shadowRay, lastOccluder[index], cacheHit) : intersector_.occluded(shadowRay)) {
+        ++stats.shadowRaysOccluded;
+        stats.occluderCacheHits += cacheHit ? 1 : 0;
+        return;
+      }
+    }
+
+    batch.push(l, nDotL, intensity);
+    if (batch.full()) {
+      result += sumPhongBatch(phong, base, n, v, batch, settings_.fastPow);
+      batch.size = 0;
+    }
+  });
+  if (batch.size > 0)
+    result += sumPhongBatch(phong, base, n, v, batch, settings_.fastPow);
+  return result;
+}
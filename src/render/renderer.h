@@ -0,0 +1,83 @@
+#ifndef RENDER_RENDERER_H
+#define RENDER_RENDERER_H
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "math/ray.h"
+#include "render/camera_rays.h"
+#include "render/framebuffer.h"
+#include "render/light_bvh.h"
+#include "render/parallel_shadow_map.h"
+#include "render/render_settings.h"
+#include "render/render_stats.h"
+#include "render/scene_intersector.h"
+#include "render/tile_scheduler.h"
+#include "render/tiles.h"
+#include "scene/scene.h"
+#include "util/scratch_arena.h"
+
+// Whitted style ray tracer: Phong shading with hard shadows, reflection and refraction.
+// Tiles are rendered in parallel on the shared TaskScheduler.
+class Renderer {
+public:
+  Renderer(const Scene &scene, const RenderSettings &settings);
+
+  // Called in row order, never concurrently, whenever rows [y0, y1) of the frame are final
+  using RowsCallback = std::function<void(int y0, int y1)>;
+
+  void render(Framebuffer &fb, const RowsCallback &onRows = {});
+
+  // Called after every progressive pass with the current average and the samples per pixel so far
+  using PassCallback = std::function<void(const Framebuffer &, int)>;
+
+  // Renders samplesPerPixel samples in passes of 1, 1, 2, 4, ... samples per pixel,
+  // fb holds the average of all samples so far when onPass is called
+  void renderProgressive(Framebuffer &fb, const PassCallback &onPass);
+
+  const RenderStats &stats() const {
+    return stats_;
+  }
+
+  // timings of the tiles of the last render() in execution order
+  const std::vector<TileTiming> &tileTimings() const {
+    return tileTimings_;
+  }
+
+private:
+  // traces one pixel per cost map cell and records how long it took
+  CostMap estimateCost(const Framebuffer &fb);
+  // runs fn for every tile on all workers, in order of 'tiles', and records tile timings.
+  // The worker's scratch arena is reset before every tile.
+  void runTiles(const std::vector<Tile> &tiles, const std::vector<double> &estimates,
+                const std::function<void(const Tile &, RenderStats &)> &fn);
+  void renderTile(Framebuffer &fb, const Tile &tile, RenderStats &stats) const;
+  // adds samples [firstSample, firstSample + count) of every pixel to 'sum'
+  void accumulateTile(Framebuffer &sum, const Tile &tile, int firstSample, int count, RenderStats &stats) const;
+  void refineTile(Framebuffer &fb, const Framebuffer &base, const Tile &tile, RenderStats &stats) const;
+  Color tracePixelSample(int x, int y, int sample, RenderStats &stats) const;
+  // iterative over the reflection/refraction tree, the ray stack lives in the thread's scratch arena
+  Color trace(const Ray &primary, RenderStats &stats) const;
+  // coneWidth: width of the ray cone at the hit, selects the texture mip level
+  Color shade(const Ray &ray, const SurfaceInteraction &si, float coneWidth, RenderStats &stats) const;
+
+  const Scene &scene_;
+  RenderSettings settings_;
+  CameraRays cameraRays_;
+  SceneIntersector intersector_;
+  LightBVH lights_;
+  OccluderCache occluders_;
+  ScratchArenas scratch_;
+  // per light index, null unless the light is parallel and shadow maps are enabled
+  std::vector<std::unique_ptr<ParallelShadowMap>> shadowMaps_;
+  // spread angle of the ray cone of one camera sample
+  float coneSpread_;
+  RenderStats stats_;
+  std::mutex statsMutex_;
+  std::vector<TileTiming> tileTimings_;
+  std::chrono::steady_clock::time_point frameStart_;
+};
+
+#endif
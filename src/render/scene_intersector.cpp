@@ -0,0 +1,59 @@
+#include "render/scene_intersector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Rough relative cost of an any-hit query, spheres are a single quadratic, meshes walk a BVH
+float occlusionCost(const Surface &s) {
+  if (s.type() == SurfaceType::MESH)
+    return 1.f + std::log2(1.f + static_cast<float>(static_cast<const Mesh &>(s).triangles().size()));
+  return 1.f;
+}
+
+} // namespace
+
+SceneIntersector::SceneIntersector(const Scene &scene) : scene_(scene) {
+  // a shadow ray can stop at the first occluder, so test surfaces with a large projected
+  // area (high hit probability) and a cheap intersection first
+  for (const auto &s : scene_.surfaces()) {
+    occlusionOrder_.push_back(s.get());
+    bounds_.expand(s->worldBounds());
+  }
+  std::stable_sort(occlusionOrder_.begin(), occlusionOrder_.end(), [](const Surface *a, const Surface *b) {
+    return a->worldBounds().surfaceArea() / occlusionCost(*a) > b->worldBounds().surfaceArea() / occlusionCost(*b);
+  });
+}
+
+bool SceneIntersector::intersect(Ray &ray, Hit &hit) const {
+  bool found = false;
+  for (const auto &s : scene_.surfaces())
+    found |= s->intersect(ray, hit);
+  return found;
+}
+
+bool SceneIntersector::occluded(const Ray &ray) const {
+  uint32_t primId;
+  for (const Surface *s : occlusionOrder_) {
+    if (s->occluded(ray, primId))
+      return true;
+  }
+  return false;
+}
+
+bool SceneIntersector::occluded(const Ray &ray, Occluder &last, bool &cacheHit) const {
+  cacheHit = last.surface && last.surface->occludedBy(ray, last.primId);
+  if (cacheHit)
+    return true;
+
+  // a miss keeps the old occluder, the next ray towards the same light may be blocked by it again
+  uint32_t primId;
+  for (const Surface *s : occlusionOrder_) {
+    if (s->occluded(ray, primId)) {
+      last = {s, primId};
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,59 @@
+#ifndef RENDER_SCENE_INTERSECTOR_H
+#define RENDER_SCENE_INTERSECTOR_H
+
+#include <vector>
+
+#include "math/ray.h"
+#include "scene/scene.h"
+#include "util/task_scheduler.h"
+
+// Surface and primitive that blocked an earlier shadow ray
+struct Occluder {
+  const Surface *surface = nullptr;
+  uint32_t primId = 0;
+};
+
+// Scene level ray queries shared by the depth-first and wavefront renderers
+class SceneIntersector {
+public:
+  explicit SceneIntersector(const Scene &scene);
+
+  // closest hit over all surfaces
+  bool intersect(Ray &ray, Hit &hit) const;
+  // any hit over all surfaces, for shadow rays
+  bool occluded(const Ray &ray) const;
+  // any hit that tests 'last' first; a full query stores the occluder it finds in 'last'.
+  // cacheHit is set when the cached occluder alone answered the query.
+  bool occluded(const Ray &ray, Occluder &last, bool &cacheHit) const;
+
+  // union of all surface bounds
+  const Bounds3 &bounds() const {
+    return bounds_;
+  }
+
+private:
+  const Scene &scene_;
+  // surfaces sorted by likelihood of blocking a shadow ray per unit of intersection cost
+  std::vector<const Surface *> occlusionOrder_;
+  Bounds3 bounds_;
+};
+
+// Last occluder per light for every pool thread: shadow rays of neighbouring pixels towards
+// the same light are often blocked by the same primitive. Each thread owns its own slots.
+class OccluderCache {
+public:
+  explicit OccluderCache(size_t lightCount)
+      // every thread's block starts on its own cache line (4 slots of 16 bytes)
+      : stride_((lightCount + 3) & ~size_t{3}), slots_(stride_ * TaskScheduler::instance().threadCount()) {}
+
+  // slots of the calling thread, indexed like Scene::lights()
+  Occluder *forCurrentThread() const {
+    return slots_.data() + stride_ * TaskScheduler::currentThreadIndex();
+  }
+
+private:
+  size_t stride_;
+  mutable std::vector<Occluder> slots_;
+};
+
+#endif
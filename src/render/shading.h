@@ -0,0 +1,90 @@
+#ifndef RENDER_SHADING_H
+#define RENDER_SHADING_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "math/color.h"
+#include "math/ray.h"
+#include "scene/lights/utils/lights.h"
+#include "scene/surfaces/hit.h"
+#include "scene/surfaces/material.h"
+
+// Shading helpers shared by the depth-first and wavefront renderers
+
+// offset along the normal for secondary ray origins to avoid self intersection
+constexpr float kRayEpsilon = 1e-4f;
+
+inline Vec3 reflect(const Vec3 &d, const Vec3 &n) {
+  return d - n * (2.f * dot(d, n));
+}
+
+// Mip level for a ray cone of width 'coneWidth' at the hit (ray cones, Akenine-Moeller et
+// al. 2019): the footprint on the surface grows with 1 / cos of the incident angle, uvScale
+// converts it to texture coordinates and the texture size to texels.
+inline float textureLod(const SurfaceInteraction &si, const Vec3 &dir, float coneWidth) {
+  const Texture *texture = si.material->texture();
+  if (!texture || !texture->loaded() || si.uvScale <= 0.f || coneWidth <= 0.f)
+    return 0.f;
+  const float cosTheta = std::max(0.05f, std::fabs(dot(si.normal, dir)));
+  const float texels = std::sqrt(static_cast<float>(texture->width()) * static_cast<float>(texture->height()));
+  const float footprint = coneWidth / cosTheta * si.uvScale * texels;
+  return footprint > 1.f ? std::log2(footprint) : 0.f;
+}
+
+// Returns false on total internal reflection
+inline bool refract(const Vec3 &d, const Vec3 &n, float eta, Vec3 &out) {
+  const float cosI = -dot(d, n);
+  const float k = 1.f - eta * eta * (1.f - cosI * cosI);
+  if (k < 0.f)
+    return false;
+  out = (d * eta + n * (eta * cosI - std::sqrt(k))).normalized();
+  return true;
+}
+
+// Smooth spot falloff between the inner (alpha1) and outer (alpha2) cone, cosTheta is the
+// cosine between the spot axis and the direction from the light to the point
+inline float spotFalloff(const SpotLight &spot, float cosTheta) {
+  if (cosTheta >= spot.cosAlpha1())
+    return 1.f;
+  const float t = (cosTheta - spot.cosAlpha2()) / (spot.cosAlpha1() - spot.cosAlpha2());
+  return t * t * (3.f - 2.f * t);
+}
+
+// Direction towards the light, the distance a shadow ray has to cover and the light
+// intensity arriving at p. Returns false for lights that have no direct contribution at p
+// (ambient, or p outside the outer cone of a spot light) so the caller can skip both the
+// shadow ray and the Phong term.
+inline bool lightDirection(const Light &light, const Vec3 &p, Vec3 &l, float &maxDist, Color &intensity) {
+  switch (light.type()) {
+  case LightType::POINT: {
+    const Vec3 toLight = static_cast<const PointLight &>(light).position() - p;
+    maxDist = toLight.length();
+    l = toLight / maxDist;
+    intensity = light.color();
+    return true;
+  }
+  case LightType::PARALLEL:
+    l = -static_cast<const ParallelLight &>(light).direction();
+    maxDist = std::numeric_limits<float>::infinity();
+    intensity = light.color();
+    return true;
+  case LightType::SPOT: {
+    const SpotLight &spot = static_cast<const SpotLight &>(light);
+    const Vec3 toLight = spot.position() - p;
+    maxDist = toLight.length();
+    l = toLight / maxDist;
+    // cone precheck: outside alpha2 the spot contributes nothing, skip shadow ray and shading
+    const float cosTheta = -dot(spot.direction(), l);
+    if (cosTheta <= spot.cosAlpha2())
+      return false;
+    intensity = light.color() * spotFalloff(spot, cosTheta);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+#endif
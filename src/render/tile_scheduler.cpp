@@ -0,0 +1,124 @@
+#include "render/tile_scheduler.h"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+// a tile may be at most this fraction of the per-thread share of the frame before it is split
+constexpr double kMaxShareFraction = 0.25;
+constexpr size_t kReportSlowest = 5;
+
+struct CostedTile {
+  Tile tile;
+  double cost;
+};
+
+void splitRecursive(const Tile &tile, const CostMap &cost, double maxCost, int minTileSize, std::vector<CostedTile> &out) {
+  const double c = cost.regionCost(tile);
+  const int w = tile.x1 - tile.x0;
+  const int h = tile.y1 - tile.y0;
+  if (c <= maxCost || (w < 2 * minTileSize && h < 2 * minTileSize)) {
+    out.push_back({tile, c});
+    return;
+  }
+
+  const int mx = w >= 2 * minTileSize ? tile.x0 + w / 2 : tile.x1;
+  const int my = h >= 2 * minTileSize ? tile.y0 + h / 2 : tile.y1;
+  const Tile parts[4] = {{tile.x0, tile.y0, mx, my}, {mx, tile.y0, tile.x1, my},
+                         {tile.x0, my, mx, tile.y1}, {mx, my, tile.x1, tile.y1}};
+  for (const Tile &p : parts) {
+    if (p.x1 > p.x0 && p.y1 > p.y0)
+      splitRecursive(p, cost, maxCost, minTileSize, out);
+  }
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+  return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))];
+}
+
+} // namespace
+
+CostMap::CostMap(int width, int height, int stride)
+    : gridWidth_((width + stride - 1) / stride), gridHeight_((height + stride - 1) / stride), stride_(stride),
+      samples_(static_cast<size_t>(gridWidth_) * gridHeight_, 0.0) {}
+
+double CostMap::regionCost(const Tile &tile) const {
+  double sum = 0.0;
+  int count = 0;
+  for (int gy = tile.y0 / stride_; gy <= (tile.y1 - 1) / stride_ && gy < gridHeight_; ++gy) {
+    for (int gx = tile.x0 / stride_; gx <= (tile.x1 - 1) / stride_ && gx < gridWidth_; ++gx) {
+      sum += samples_[static_cast<size_t>(gy) * gridWidth_ + gx];
+      ++count;
+    }
+  }
+  if (count == 0)
+    return 0.0;
+  // average sample cost times the pixels of the region
+  return sum / count * static_cast<double>(tile.x1 - tile.x0) * static_cast<double>(tile.y1 - tile.y0);
+}
+
+std::vector<Tile> planTiles(const std::vector<Tile> &tiles, const CostMap &cost, unsigned threadCount, int minTileSize) {
+  double total = 0.0;
+  for (const Tile &t : tiles)
+    total += cost.regionCost(t);
+  const double maxCost = total / std::max(1u, threadCount) * kMaxShareFraction;
+
+  std::vector<CostedTile> costed;
+  for (const Tile &t : tiles)
+    splitRecursive(t, cost, maxCost, minTileSize, costed);
+
+  std::stable_sort(costed.begin(), costed.end(), [](const CostedTile &a, const CostedTile &b) {
+    return a.cost > b.cost;
+  });
+
+  std::vector<Tile> ordered;
+  ordered.reserve(costed.size());
+  for (const CostedTile &c : costed)
+    ordered.push_back(c.tile);
+  return ordered;
+}
+
+void printTileReport(std::ostream &os, const std::vector<TileTiming> &timings) {
+  if (timings.empty())
+    return;
+
+  std::vector<double> durations;
+  std::map<unsigned, double> threadEnd;
+  double frameEnd = 0.0;
+  for (const TileTiming &t : timings) {
+    durations.push_back(t.endMs - t.startMs);
+    threadEnd[t.thread] = std::max(threadEnd[t.thread], t.endMs);
+    frameEnd = std::max(frameEnd, t.endMs);
+  }
+  double firstIdle = frameEnd;
+  for (const auto &te : threadEnd)
+    firstIdle = std::min(firstIdle, te.second);
+
+  os << "Tiles{count=" << timings.size()
+     << ", p50_ms=" << percentile(durations, 0.5)
+     << ", p95_ms=" << percentile(durations, 0.95)
+     << ", max_ms=" << percentile(durations, 1.0)
+     << ", frame_ms=" << frameEnd
+     << ", tail_ms=" << frameEnd - firstIdle // time between the first thread running out of work and the end
+     << "}\n";
+
+  std::vector<const TileTiming *> slowest;
+  for (const TileTiming &t : timings)
+    slowest.push_back(&t);
+  const size_t n = std::min(kReportSlowest, slowest.size());
+  std::partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(), [](const TileTiming *a, const TileTiming *b) {
+    return a->endMs - a->startMs > b->endMs - b->startMs;
+  });
+  for (size_t i = 0; i < n; ++i) {
+    const TileTiming &t = *slowest[i];
+    os << "  tile [" << t.tile.x0 << "," << t.tile.y0 << ")-[" << t.tile.x1 << "," << t.tile.y1 << ")"
+       << " ms=" << t.endMs - t.startMs
+       << " estimated_ms=" << t.estimatedCost
+       << " start_ms=" << t.startMs
+       << " thread=" << t.thread << "\n";
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef RENDER_TILE_SCHEDULER_H
+#define RENDER_TILE_SCHEDULER_H
+
+#include <ostream>
+#include <vector>
+
+#include "render/tiles.h"
+
+// Per-pixel render cost sampled on a coarse grid (one sample every 'stride' pixels),
+// produced by the low resolution pre-pass of the tile renderer
+class CostMap {
+public:
+  CostMap(int width, int height, int stride);
+
+  int gridWidth() const { return gridWidth_; }
+  int gridHeight() const { return gridHeight_; }
+  int stride() const { return stride_; }
+
+  double &sample(int gx, int gy) { return samples_[static_cast<size_t>(gy) * gridWidth_ + gx]; }
+
+  // estimated cost of a pixel region: sum of the samples inside, scaled to the covered pixels
+  double regionCost(const Tile &tile) const;
+
+private:
+  int gridWidth_;
+  int gridHeight_;
+  int stride_;
+  std::vector<double> samples_;
+};
+
+// Cost-based tile plan: tiles whose estimated cost exceeds a fair share of the frame
+// are split into quadrants (down to 'minTileSize'), then the result is sorted by
+// decreasing cost so the expensive tiles are started first and cheap ones fill the tail.
+std::vector<Tile> planTiles(const std::vector<Tile> &tiles, const CostMap &cost, unsigned threadCount, int minTileSize);
+
+// Measured execution of one tile, times relative to the start of the frame
+struct TileTiming {
+  Tile tile;
+  double estimatedCost = 0.0; // pre-pass estimate (0 without pre-pass)
+  double startMs = 0.0;
+  double endMs = 0.0;
+  unsigned thread = 0;
+};
+
+// Summary of the tile timings: distribution, slowest tiles and how far apart the threads finished
+void printTileReport(std::ostream &os, const std::vector<TileTiming> &timings);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef RENDER_TILES_H
+#define RENDER_TILES_H
+
+#include <algorithm>
+#include <vector>
+
+// Image region [x0, x1) x [y0, y1), the unit of work of the tile renderer
+struct Tile {
+  int x0 = 0, y0 = 0;
+  int x1 = 0, y1 = 0;
+};
+
+// Splits the image into row-major square tiles of 'size' pixels (smaller at the borders)
+inline std::vector<Tile> makeTiles(int width, int height, int size) {
+  std::vector<Tile> tiles;
+  for (int y = 0; y < height; y += size)
+    for (int x = 0; x < width; x += size)
+      tiles.push_back({x, y, std::min(width, x + size), std::min(height, y + size)});
+  return tiles;
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include "render/wavefront_renderer.h"
+
+#include "render/ray_sorting.h"
+#include "render/phong_batch.h"
+#include "render/shading.h"
+#include "util/heap_guard.h"
+#include "util/task_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// rays per task of the parallel intersect/shadow kernels
+constexpr size_t kKernelGrain = 1024;
+
+// result of a shadow ray in the shadow stage
+constexpr uint8_t kVisible = 0;
+constexpr uint8_t kOccluded = 1;
+constexpr uint8_t kOccludedCached = 2; // answered by the occluder cache
+
+double elapsedMs(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+WavefrontRenderer::WavefrontRenderer(const Scene &scene, const RenderSettings &settings)
+    : scene_(scene), settings_(settings), cameraRays_(scene.camera()),
+      coneSpread_(cameraRays_.pixelSpreadAngle() / std::sqrt(static_cast<float>(std::max(1, settings.samplesPerPixel)))),
+      intersector_(scene),
+      lights_(scene, settings.lightCullPower), occluders_(scene.lights().size()) {
+  const auto start = std::chrono::steady_clock::now();
+  shadowMaps_ = buildParallelShadowMaps(scene, settings.shadowMapResolution);
+  stats_.shadowMapMs = elapsedMs(start);
+}
+
+void WavefrontRenderer::render(Framebuffer &fb) {
+  const uint32_t pixelCount = static_cast<uint32_t>(fb.width()) * static_cast<uint32_t>(fb.height());
+  const uint32_t batch = std::max<uint32_t>(1, settings_.wavefrontBatchSize);
+  const size_t spp = static_cast<size_t>(std::max(1, settings_.samplesPerPixel));
+
+  rays_.reserve(std::min(batch, pixelCount) * spp);
+  nextRays_.reserve(std::min(batch, pixelCount) * spp);
+
+  for (uint32_t begin = 0; begin < pixelCount; begin += batch) {
+    generate(fb, begin, std::min(pixelCount, begin + batch));
+
+    // one iteration per bounce until no secondary rays are left
+    bool primary = true;
+    while (rays_.size() > 0) {
+      if (!primary && settings_.sortRays) {
+        const auto sortStart = std::chrono::steady_clock::now();
+        sortRays(rays_, sortScratch_, sortKeys_, intersector_.bounds());
+        stats_.raySortMs += elapsedMs(sortStart);
+        stats_.sortedRays += rays_.size();
+      }
+
+      const auto intersectStart = std::chrono::steady_clock::now();
+      intersect();
+      if (!primary)
+        stats_.secondaryIntersectMs += elapsedMs(intersectStart);
+      primary = false;
+
+      shade(fb);
+      traceShadows(fb);
+      std::swap(rays_, nextRays_);
+      nextRays_.clear();
+      nextRays_.tMin = 0.f;
+    }
+
+    // samples are traced with full weight (as in Renderer, so minThroughput culls the same
+    // rays) and averaged once the batch is complete
+    if (spp > 1) {
+      for (uint32_t i = begin; i < std::min(pixelCount, begin + batch); ++i)
+        fb.pixel(i) = fb.pixel(i) / static_cast<float>(spp);
+    }
+  }
+}
+
+void WavefrontRenderer::generate(const Framebuffer &fb, uint32_t begin, uint32_t end) {
+  rays_.clear();
+  rays_.tMin = 0.f;
+  const uint32_t width = static_cast<uint32_t>(fb.width());
+  const int spp = std::max(1, settings_.samplesPerPixel);
+  for (uint32_t i = begin; i < end; ++i) {
+    const float x = static_cast<float>(i % width);
+    const float y = static_cast<float>(i / width);
+    for (int s = 0; s < spp; ++s) {
+      float ox, oy;
+      sampleOffset(s, ox, oy);
+      rays_.push(cameraRays_.generate(x + ox, y + oy), 1.f, i, 0, 0.f);
+    }
+  }
+  stats_.primaryRays += static_cast<uint64_t>(end - begin) * static_cast<uint64_t>(spp);
+}
+
+void WavefrontRenderer::intersect() {
+  const size_t n = rays_.size();
+  hits_.resize(n);
+  parallelFor(0, n, kKernelGrain, [this](size_t begin, size_t end) {
+    HeapGuard guard("the intersect kernel");
+    for (size_t i = begin; i < end; ++i) {
+      Ray ray = rays_.ray(i);
+      Hit hit;
+      const bool found = intersector_.intersect(ray, hit);
+      hits_.set(i, hit, found);
+    }
+  });
+}
+
+// Accumulates ambient and background terms, queues one shadow ray per lit light and
+// spawns the next generation of reflection/refraction rays. Chunks of rays are shaded in
+// parallel, their outputs are applied serially in ray order.
+void WavefrontRenderer::shade(Framebuffer &fb) {
+  const size_t n = rays_.size();
+  const size_t chunks = (n + kKernelGrain - 1) / kKernelGrain;
+  if (shadeChunks_.size() < chunks)
+    shadeChunks_.resize(chunks);
+  parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c)
+      shadeRange(c * kKernelGrain, std::min(n, (c + 1) * kKernelGrain), shadeChunks_[c]);
+  });
+
+  shadows_.clear();
+  nextRays_.tMin = Ray{}.tMin;
+  for (size_t c = 0; c < chunks; ++c) {
+    const ShadeChunk &chunk = shadeChunks_[c];
+    for (const auto &add : chunk.pixelAdds)
+      fb.pixel(add.first) += add.second;
+    nextRays_.append(chunk.rays);
+    shadows_.append(chunk.shadows);
+    stats_ += chunk.stats;
+  }
+}
+
+void WavefrontRenderer::shadeRange(size_t begin, size_t end, ShadeChunk &out) const {
+  const int maxBounces = scene_.camera().maxBounces();
+  out.rays.clear();
+  out.shadows.clear();
+  out.pixelAdds.clear();
+  out.stats = RenderStats{};
+
+  for (size_t i = begin; i < end; ++i) {
+    const uint32_t pixel = rays_.pixel[i];
+    const float throughput = rays_.throughput[i];
+    if (!hits_.surface[i]) {
+      out.pixelAdds.emplace_back(pixel, scene_.backgroundColor() * throughput);
+      continue;
+    }
+
+    const Ray ray = rays_.ray(i);
+    const Hit hit = hits_.hit(i);
+    const SurfaceInteraction si = hit.surface->interaction(ray, hit);
+    const Material &m = *si.material;
+    const PhongParams &phong = m.phong();
+    const float coneWidth = rays_.coneWidth[i] + coneSpread_ * hit.t;
+    const Color base = m.baseColor(si.uv.x, si.uv.y, textureLod(si, ray.direction, coneWidth));
+
+    const int depth = rays_.depth[i];
+    const float kr = m.reflectance();
+    const float kt = m.transmittance();
+    const float localWeight = depth >= maxBounces ? throughput : throughput * std::max(0.f, 1.f - kr - kt);
+
+    const Vec3 v = -ray.direction;
+    const Vec3 nv = dot(si.normal, v) < 0.f ? -si.normal : si.normal;
+
+    if (scene_.ambientLight())
+      out.pixelAdds.emplace_back(pixel, scene_.ambientLight()->color() * base * (phong.kAmbient * localWeight));
+
+    // Phong terms of the facing lights are evaluated a batch at a time, then queued with their shadow rays
+    const Vec3 shadowOrigin = si.point + nv * kRayEpsilon;
+    PhongBatch batch;
+    float shadowDist[PhongBatch::kCapacity];
+    uint32_t lightIndex[PhongBatch::kCapacity];
+    bool lit[PhongBatch::kCapacity]; // known to be unoccluded from the shadow map
+    auto queueBatch = [&] {
+      float r[PhongBatch::kCapacity], g[PhongBatch::kCapacity], b[PhongBatch::kCapacity];
+      evaluatePhongBatch(phong, base, nv, v, batch, settings_.fastPow, r, g, b);
+      for (int k = 0; k < batch.size; ++k) {
+        const Color contribution = Color{r[k], g[k], b[k]} * localWeight;
+        if (lit[k])
+          out.pixelAdds.emplace_back(pixel, contribution);
+        else
+          out.shadows.push(shadowOrigin, Vec3{batch.lx[k], batch.ly[k], batch.lz[k]}, shadowDist[k], contribution, pixel,
+                        lightIndex[k]);
+      }
+      batch.size = 0;
+    };
+    lights_.forEachLight(si.point, nv, out.stats.culledLights, [&](const Light &light, uint32_t index) {
+      Vec3 l;
+      float maxDist;
+      Color intensity;
+      if (!lightDirection(light, si.point, l, maxDist, intensity))
+        return;
+      const float nDotL = dot(nv, l);
+      if (nDotL <= 0.f)
+        return;
+      const ParallelShadowMap *shadowMap = shadowMaps_[index].get();
+      const auto visibility = shadowMap ? shadowMap->classify(shadowOrigin) : ParallelShadowMap::Visibility::UNKNOWN;
+      if (visibility == ParallelShadowMap::Visibility::SHADOWED) {
+        ++out.stats.shadowMapShadowed;
+        return;
+      }
+      out.stats.shadowMapLit += visibility == ParallelShadowMap::Visibility::LIT ? 1 : 0;
+      shadowDist[batch.size] = maxDist - kRayEpsilon;
+      lightIndex[batch.size] = index;
+      lit[batch.size] = visibility == ParallelShadowMap::Visibility::LIT;
+      batch.push(l, nDotL, intensity);
+      if (batch.full())
+        queueBatch();
+    });
+    if (batch.size > 0)
+      queueBatch();
+
+    if (depth >= maxBounces)
+      continue;
+
+    const bool entering = dot(ray.direction, si.normal) < 0.f;
+    const Vec3 n = entering ? si.normal : -si.normal;
+    const Vec3 reflected = reflect(ray.direction, n).normalized();
+
+    auto spawn = [&](const Ray &next, float factor) {
+      if (factor <= 0.f)
+        return;
+      const float weight = throughput * factor;
+      if (weight < settings_.minThroughput) {
+        ++out.stats.culledRays;
+        return;
+      }
+      ++out.stats.secondaryRays;
+      out.rays.push(next, weight, pixel, depth + 1, coneWidth);
+    };
+
+    spawn(Ray{si.point + n * kRayEpsilon, reflected}, kr);
+
+    if (kt > 0.f) {
+      const float eta = entering ? 1.f / m.ior() : m.ior();
+      Vec3 refracted;
+      if (refract(ray.direction, n, eta, refracted))
+        spawn(Ray{si.point - n * kRayEpsilon, refracted}, kt);
+      else
+        spawn(Ray{si.point + n * kRayEpsilon, reflected}, kt); // total internal reflection
+    }
+  }
+}
+
+void WavefrontRenderer::traceShadows(Framebuffer &fb) {
+  const size_t n = shadows_.size();
+  stats_.shadowRays += n;
+
+  // occlusion tests in parallel, accumulation serially since several shadow rays share a pixel.
+  // The queue is in pixel order, so consecutive rays of one thread are coherent for the occluder cache.
+  visible_.resize(n);
+  parallelFor(0, n, kKernelGrain, [this](size_t begin, size_t end) {
+    HeapGuard guard("the shadow kernel");
+    Occluder *lastOccluder = settings_.occluderCache ? occluders_.forCurrentThread() : nullptr;
+    for (size_t i = begin; i < end; ++i) {
+      if (!lastOccluder) {
+        visible_[i] = intersector_.occluded(shadows_.ray(i)) ? kOccluded : kVisible;
+        continue;
+      }
+      bool cacheHit;
+      const bool blocked = intersector_.occluded(shadows_.ray(i), lastOccluder[shadows_.light[i]], cacheHit);
+      visible_[i] = cacheHit ? kOccludedCached : (blocked ? kOccluded : kVisible);
+    }
+  });
+
+  for (size_t i = 0; i < n; ++i) {
+    if (visible_[i] != kVisible) {
+      ++stats_.shadowRaysOccluded;
+      stats_.occluderCacheHits += visible_[i] == kOccludedCached ? 1 : 0;
+      continue;
+    }
+    fb.pixel(shadows_.pixel[i]) += Color{shadows_.r[i], shadows_.g[i], shadows_.b[i]};
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef RENDER_WAVEFRONT_RENDERER_H
+#define RENDER_WAVEFRONT_RENDERER_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "render/camera_rays.h"
+#include "render/framebuffer.h"
+#include "render/light_bvh.h"
+#include "render/parallel_shadow_map.h"
+#include "render/ray_queue.h"
+#include "render/render_settings.h"
+#include "render/render_stats.h"
+#include "render/scene_intersector.h"
+#include "scene/scene.h"
+
+// Breadth-first variant of Renderer: pixels are processed in large batches (samplesPerPixel
+// camera rays each, at the same sample positions as Renderer) and every
+// bounce runs as separate stages (generate, intersect, shade, shadow) over SoA queues.
+// Produces the same image as the depth-first renderer. The intersect, shade and shadow
+// stages run in parallel on the shared TaskScheduler.
+class WavefrontRenderer {
+public:
+  WavefrontRenderer(const Scene &scene, const RenderSettings &settings);
+
+  void render(Framebuffer &fb);
+
+  const RenderStats &stats() const {
+    return stats_;
+  }
+
+private:
+  // Output of one chunk of the shade stage. Chunks are merged in order, so the image and the
+  // order of the next generation do not depend on the thread count.
+  struct ShadeChunk {
+    RayQueue rays;
+    ShadowQueue shadows;
+    std::vector<std::pair<uint32_t, Color>> pixelAdds; // in the order of the serial loop
+    RenderStats stats;
+  };
+
+  void generate(const Framebuffer &fb, uint32_t begin, uint32_t end);
+  void intersect();
+  void shade(Framebuffer &fb);
+  void shadeRange(size_t begin, size_t end, ShadeChunk &out) const;
+  void traceShadows(Framebuffer &fb);
+
+  const Scene &scene_;
+  RenderSettings settings_;
+  CameraRays cameraRays_;
+  // ray cone spread per unit distance, narrowed by supersampling like in Renderer
+  float coneSpread_;
+  SceneIntersector intersector_;
+  LightBVH lights_;
+  OccluderCache occluders_;
+  // per light index, null unless the light is parallel and shadow maps are enabled
+  std::vector<std::unique_ptr<ParallelShadowMap>> shadowMaps_;
+
+  RayQueue rays_;
+  RayQueue nextRays_;
+  RayQueue sortScratch_;
+  std::vector<std::pair<uint64_t, uint32_t>> sortKeys_;
+  HitQueue hits_;
+  std::vector<ShadeChunk> shadeChunks_;
+  ShadowQueue shadows_;
+  std::vector<uint8_t> visible_;
+
+  RenderStats stats_;
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "scene/accel/bvh.h"
+#include "scene/surfaces/mesh.h"
+#include "util/task_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kMaxLeafSize = 4;
+// the triangle count of a leaf is stored in 16 bits
+constexpr uint32_t kMaxLeafCount = std::numeric_limits<decltype(BVHNode::count)>::max();
+// subtrees with at least this many triangles are built as separate tasks
+constexpr uint32_t kParallelBuildThreshold = 4096;
+
+Bounds3 triangleBounds(const TrianglePrimitive &t) {
+  Bounds3 b;
+  b.expand(t.v0);
+  b.expand(t.v1);
+  b.expand(t.v2);
+  return b;
+}
+
+float triangleArea(const TrianglePrimitive &t) {
+  return 0.5f * cross(t.v1 - t.v0, t.v2 - t.v0).length();
+}
+
+struct BuildPrim {
+  Bounds3 bounds;
+  Vec3 centroid;
+  uint32_t index;
+};
+
+uint32_t buildRecursive(std::vector<BVHNode> &nodes, std::vector<BuildPrim> &prims, uint32_t begin, uint32_t end);
+
+// Appends a subtree built into its own vector, child links are relative to the subtree root
+void appendSubtree(std::vector<BVHNode> &nodes, const std::vector<BVHNode> &subtree) {
+  const uint32_t base = static_cast<uint32_t>(nodes.size());
+  for (BVHNode node : subtree) {
+    if (node.count == 0)
+      node.offset += base;
+    nodes.push_back(node);
+  }
+}
+
+// Builds both children of a node, large ranges fork the left half onto the scheduler.
+// Returns the index of the second child.
+uint32_t buildChildren(std::vector<BVHNode> &nodes, std::vector<BuildPrim> &prims, uint32_t begin, uint32_t mid, uint32_t end) {
+  if (end - begin < kParallelBuildThreshold) {
+    buildRecursive(nodes, prims, begin, mid);
+    return buildRecursive(nodes, prims, mid, end);
+  }
+
+  // the halves touch disjoint ranges of 'prims' and write into separate node arrays
+  std::vector<BVHNode> leftNodes, rightNodes;
+  TaskGroup group;
+  group.run([&] { buildRecursive(leftNodes, prims, begin, mid); });
+  buildRecursive(rightNodes, prims, mid, end);
+  group.wait();
+
+  appendSubtree(nodes, leftNodes);
+  const uint32_t right = static_cast<uint32_t>(nodes.size());
+  appendSubtree(nodes, rightNodes);
+  return right;
+}
+
+// Recursive median split on the largest centroid axis, returns the index of the created node
+uint32_t buildRecursive(std::vector<BVHNode> &nodes, std::vector<BuildPrim> &prims, uint32_t begin, uint32_t end) {
+  const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+
+  Bounds3 bounds, centroidBounds;
+  for (uint32_t i = begin; i < end; ++i) {
+    bounds.expand(prims[i].bounds);
+    centroidBounds.expand(prims[i].centroid);
+  }
+  nodes[nodeIndex].bounds = bounds;
+
+  const uint32_t count = end - begin;
+  const int axis = centroidBounds.largestAxis();
+  const bool sameCentroid = axisValue(centroidBounds.extent(), axis) <= 0.f;
+  if (count <= kMaxLeafSize || (sameCentroid && count <= kMaxLeafCount)) {
+    nodes[nodeIndex].offset = begin;
+    nodes[nodeIndex].count = static_cast<uint16_t>(count);
+    return nodeIndex;
+  }
+
+  // triangles sharing one centroid cannot be ordered, too many of them for one leaf are
+  // split at the index midpoint
+  const uint32_t mid = begin + count / 2;
+  if (!sameCentroid)
+    std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+                     [axis](const BuildPrim &a, const BuildPrim &b) {
+                       return axisValue(a.centroid, axis) < axisValue(b.centroid, axis);
+                     });
+
+  const uint32_t right = buildChildren(nodes, prims, begin, mid, end);
+
+  BVHNode &node = nodes[nodeIndex];
+  node.offset = right;
+  node.axis = static_cast<uint8_t>(axis);
+  node.occludeFirst = nodes[right].bounds.surfaceArea() > nodes[nodeIndex + 1].bounds.surfaceArea() ? 1 : 0;
+  return nodeIndex;
+}
+
+Vec3 inverseDirection(const Vec3 &d) {
+  return {1.f / d.x, 1.f / d.y, 1.f / d.z};
+}
+
+} // namespace
+
+bool intersectTriangle(const TrianglePrimitive &tri, const Ray &ray, float &t, float &b1, float &b2) {
+  const Vec3 e1 = tri.v1 - tri.v0;
+  const Vec3 e2 = tri.v2 - tri.v0;
+  const Vec3 p = cross(ray.direction, e2);
+  const float det = dot(e1, p);
+  if (std::fabs(det) < 1e-12f)
+    return false;
+
+  const float invDet = 1.f / det;
+  const Vec3 s = ray.origin - tri.v0;
+  const float u = dot(s, p) * invDet;
+  if (u < 0.f || u > 1.f)
+    return false;
+
+  const Vec3 q = cross(s, e1);
+  const float v = dot(ray.direction, q) * invDet;
+  if (v < 0.f || u + v > 1.f)
+    return false;
+
+  const float dist = dot(e2, q) * invDet;
+  if (dist <= ray.tMin || dist >= ray.tMax)
+    return false;
+
+  t = dist;
+  b1 = u;
+  b2 = v;
+  return true;
+}
+
+void TriangleBVH::build(std::pmr::vector<TrianglePrimitive> &tris) {
+  nodes_.clear();
+  if (tris.empty())
+    return;
+
+  std::vector<BuildPrim> prims(tris.size());
+  parallelFor(0, tris.size(), kParallelBuildThreshold, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      prims[i].bounds = triangleBounds(tris[i]);
+      prims[i].centroid = prims[i].bounds.centroid();
+      prims[i].index = static_cast<uint32_t>(i);
+    }
+  });
+
+  // built in scratch memory, only the final array is copied into nodes_ (which may live in a
+  // monotonic scene arena that never reuses the space of a grown or reserved vector)
+  std::vector<BVHNode> nodes;
+  nodes.reserve(2 * tris.size());
+  buildRecursive(nodes, prims, 0, static_cast<uint32_t>(prims.size()));
+
+  // leaves reference contiguous ranges; inside a leaf the largest triangles come first
+  // because they are the most likely occluders for any-hit queries
+  parallelFor(0, nodes.size(), kParallelBuildThreshold, [&](size_t begin, size_t end) {
+    for (size_t n = begin; n < end; ++n) {
+      const BVHNode &node = nodes[n];
+      if (node.count == 0)
+        continue;
+      std::sort(prims.begin() + node.offset, prims.begin() + node.offset + node.count,
+                [&tris](const BuildPrim &a, const BuildPrim &b) {
+                  return triangleArea(tris[a.index]) > triangleArea(tris[b.index]);
+                });
+    }
+  });
+
+  // permuted through a scratch copy so the triangle buffer itself is kept
+  std::vector<TrianglePrimitive> ordered(tris.size());
+  parallelFor(0, prims.size(), kParallelBuildThreshold, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      ordered[i] = tris[prims[i].index];
+  });
+  parallelFor(0, ordered.size(), kParallelBuildThreshold, [&](size_t begin, size_t end) {
+    std::copy(ordered.begin() + begin, ordered.begin() + end, tris.begin() + begin);
+  });
+  nodes_.assign(nodes.begin(), nodes.end());
+}
+
+const Bounds3 &TriangleBVH::bounds() const {
+  static const Bounds3 kEmpty{};
+  return nodes_.empty() ? kEmpty : nodes_[0].bounds;
+}
+
+bool TriangleBVH::intersect(const std::pmr::vector<TrianglePrimitive> &tris, Ray &ray, TriangleHit &out) const {
+  if (nodes_.empty())
+    return false;
+
+  const Vec3 invDir = inverseDirection(ray.direction);
+  const bool dirNegative[3] = {invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f};
+
+  uint32_t stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+  bool found = false;
+
+  while (sp > 0) {
+    const BVHNode &node = nodes_[stack[--sp]];
+    float tEntry;
+    if (!intersectBounds(node.bounds, ray, invDir, tEntry))
+      continue;
+
+    if (node.count > 0) {
+      for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+        float t, b1, b2;
+        if (intersectTriangle(tris[i], ray, t, b1, b2)) {
+          ray.tMax = t;
+          out = {i, t, b1, b2};
+          found = true;
+        }
+      }
+      continue;
+    }
+
+    // push the far child first so the near child is visited next
+    const uint32_t first = static_cast<uint32_t>(&node - nodes_.data()) + 1;
+    if (dirNegative[node.axis]) {
+      stack[sp++] = first;
+      stack[sp++] = node.offset;
+    } else {
+      stack[sp++] = node.offset;
+      stack[sp++] = first;
+    }
+  }
+  return found;
+}
+
+bool TriangleBVH::occluded(const std::pmr::vector<TrianglePrimitive> &tris, const Ray &ray, uint32_t &primId) const {
+  if (nodes_.empty())
+    return false;
+
+  const Vec3 invDir = inverseDirection(ray.direction);
+
+  uint32_t stack[kStackSize];
+  int sp = 0;
+  stack[sp++] = 0;
+
+  while (sp > 0) {
+    const BVHNode &node = nodes_[stack[--sp]];
+    float tEntry;
+    if (!intersectBounds(node.bounds, ray, invDir, tEntry))
+      continue;
+
+    if (node.count > 0) {
+      for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+        float t, b1, b2;
+        if (intersectTriangle(tris[i], ray, t, b1, b2)) {
+          primId = i;
+          return true;
+        }
+      }
+      continue;
+    }
+
+    // order does not matter for correctness, visit the child most likely to contain an occluder first
+    const uint32_t first = static_cast<uint32_t>(&node - nodes_.data()) + 1;
+    if (node.occludeFirst) {
+      stack[sp++] = first;
+      stack[sp++] = node.offset;
+    } else {
+      stack[sp++] = node.offset;
+      stack[sp++] = first;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,62 @@
+#ifndef SCENE_ACCEL_BVH_H
+#define SCENE_ACCEL_BVH_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "math/bounds3.h"
+#include "math/ray.h"
+
+struct TrianglePrimitive;
+
+struct BVHNode {
+  Bounds3 bounds;
+  uint32_t offset = 0; // leaf: first triangle, interior: index of the second child (first child is this + 1)
+  uint16_t count = 0;  // number of triangles, 0 for interior nodes
+  uint8_t axis = 0;    // split axis, used for front-to-back ordering of closest-hit queries
+  uint8_t occludeFirst = 0; // child (0/1) with the larger surface area, visited first by any-hit queries
+};
+
+// Result of a closest-hit query against the triangle BVH
+struct TriangleHit {
+  uint32_t primId = 0;
+  float t = 0.f;
+  float b1 = 0.f;
+  float b2 = 0.f;
+};
+
+// Bounding volume hierarchy over the triangles of a single mesh.
+// build() reorders the triangle array so that every leaf references a contiguous range.
+class TriangleBVH {
+public:
+  // the final node array is allocated from 'resource', build scratch memory comes from the heap
+  // traversal keeps pending nodes on a fixed stack of kStackSize entries, which bounds the
+  // depth of any node (the root has depth 0)
+  static constexpr int kStackSize = 64;
+  static constexpr int kMaxDepth = kStackSize - 1;
+
+  explicit TriangleBVH(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : nodes_(resource) {}
+
+  void build(std::pmr::vector<TrianglePrimitive> &tris);
+
+  // Closest hit: near child first, shrinks ray.tMax on every hit
+  bool intersect(const std::pmr::vector<TrianglePrimitive> &tris, Ray &ray, TriangleHit &out) const;
+  // Any hit: larger child first, returns on the first intersection found and its triangle in primId
+  bool occluded(const std::pmr::vector<TrianglePrimitive> &tris, const Ray &ray, uint32_t &primId) const;
+
+  const Bounds3 &bounds() const;
+  bool empty() const { return nodes_.empty(); }
+
+  // flat node array in build order, and its counterpart for restoring a built hierarchy
+  const std::pmr::vector<BVHNode> &nodes() const { return nodes_; }
+  void assign(const BVHNode *nodes, size_t count) { nodes_.assign(nodes, nodes + count); }
+
+private:
+  std::pmr::vector<BVHNode> nodes_;
+};
+
+// Möller-Trumbore, returns t and the barycentrics of v1/v2
+bool intersectTriangle(const TrianglePrimitive &tri, const Ray &ray, float &t, float &b1, float &b2);
+
+#endif
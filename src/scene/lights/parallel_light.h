@@ -18,6 +18,12 @@ public:
     direction_ = d;
   }
 
+  // stores a direction that is already normalized bit for bit (scene snapshots),
+  // normalizing again may change the last bit
+  void setUnitDirection(const Vec3 &d) {
+    direction_ = d;
+  }
+
 private:
   Vec3 direction_{0.f, 0.f, -1.f};
 };
@@ -1,6 +1,7 @@
 #ifndef SCENE_LIGHTS_SPOT_LIGHT_H
 #define SCENE_LIGHTS_SPOT_LIGHT_H
 
+#include <cmath>
 #include <stdexcept>
 
 #include "math/vec3.h"
@@ -20,6 +21,7 @@ public:
     return direction_;
   }
 
+  // falloff angles in degrees from the spot axis: full intensity inside alpha1, none outside alpha2
   float alpha1() const {
     return alpha1_;
   }
@@ -28,6 +30,15 @@ public:
     return alpha2_;
   }
 
+  // cosines of alpha1/alpha2, a point is outside the cone if the cosine towards it is below cosAlpha2
+  float cosAlpha1() const {
+    return cosAlpha1_;
+  }
+
+  float cosAlpha2() const {
+    return cosAlpha2_;
+  }
+
   void setPosition(const Vec3 &p) {
     position_ = p;
   }
@@ -37,11 +48,20 @@ public:
     direction_ = d;
   }
 
+  // stores a direction that is already normalized bit for bit (scene snapshots),
+  // normalizing again may change the last bit
+  void setUnitDirection(const Vec3 &d) {
+    direction_ = d;
+  }
+
   void setFalloff(float a1, float a2) {
-    if (a1 < 0.f || a2 < 0.f || a1 > a2)
-      throw std::invalid_argument("Spot falloff must satisfy 0 <= alpha1 <= alpha2");
+    if (a1 < 0.f || a2 < 0.f || a1 > a2 || a2 > 180.f)
+      throw std::invalid_argument("Spot falloff must satisfy 0 <= alpha1 <= alpha2 <= 180");
     alpha1_ = a1;
     alpha2_ = a2;
+    constexpr float kDegToRad = 3.14159265358979323846f / 180.f;
+    cosAlpha1_ = std::cos(a1 * kDegToRad);
+    cosAlpha2_ = std::cos(a2 * kDegToRad);
   }
 
 private:
@@ -49,6 +69,8 @@ private:
   Vec3 direction_{0.f, 0.f, -1.f};
   float alpha1_ = 0.f;
   float alpha2_ = 0.f;
+  float cosAlpha1_ = 1.f;
+  float cosAlpha2_ = 1.f;
 };
 
 std::ostream &operator<<(std::ostream &os, const SpotLight &l);
@@ -2,6 +2,7 @@
 #define SCENE_H
 
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <ostream>
 #include <stdexcept>
@@ -12,11 +13,15 @@
 #include "math/color.h"
 #include "scene/camera.h"
 #include "scene/lights/utils/lights.h"
+#include "scene/scene_arena.h"
 #include "scene/surfaces/surface.h"
 #include "scene/surfaces/surface_io.h"
+#include "scene/textures/texture_manager.h"
 
 class Scene {
 public:
+  Scene() : lights_(arena_.resource()), surfaces_(arena_.resource()) {}
+
   // getter
   const std::string &outputFileName() const {
     return outputFileName_;
@@ -34,14 +39,18 @@ public:
     return ambient_;
   }
 
-  const std::vector<std::unique_ptr<Light>> &lights() const {
+  const std::pmr::vector<ArenaPtr<Light>> &lights() const {
     return lights_;
   }
 
-  const std::vector<std::unique_ptr<Surface>> &surfaces() const {
+  const std::pmr::vector<ArenaPtr<Surface>> &surfaces() const {
     return surfaces_;
   }
 
+  const TextureManager &textures() const {
+    return textures_;
+  }
+
   // setter
   void setOutputFileName(std::string path) {
     outputFileName_ = std::move(path);
@@ -59,21 +68,32 @@ public:
     ambient_ = a;
   }
 
-  void addLight(std::unique_ptr<Light> l) {
+  // surfaces and lights are created with arena().make<T>()
+  SceneArena &arena() {
+    return arena_;
+  }
+
+  void addLight(ArenaPtr<Light> l) {
     lights_.push_back(std::move(l));
   }
 
-  void addSurface(std::unique_ptr<Surface> s) {
+  void addSurface(ArenaPtr<Surface> s) {
     surfaces_.push_back(std::move(s));
   }
 
+  TextureManager &texturesMutable() {
+    return textures_;
+  }
+
 private:
+  SceneArena arena_; // declared first: outlives everything allocated from it
   std::string outputFileName_;
   Color backgroundColor_{0.f, 0.f, 0.f};
   Camera camera_{};
   std::optional<AmbientLight> ambient_;
-  std::vector<std::unique_ptr<Light>> lights_;
-  std::vector<std::unique_ptr<Surface>> surfaces_;
+  std::pmr::vector<ArenaPtr<Light>> lights_;
+  std::pmr::vector<ArenaPtr<Surface>> surfaces_;
+  TextureManager textures_;
 };
 
 inline std::ostream &operator<<(std::ostream &os, const Scene &s) {
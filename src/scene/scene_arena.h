@@ -0,0 +1,47 @@
+#ifndef SCENE_ARENA_H
+#define SCENE_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+// Deleter for objects placed in a SceneArena: runs the destructor only, the memory is
+// released together with the arena
+struct ArenaDelete {
+  template <class T>
+  void operator()(T *p) const {
+    p->~T();
+  }
+};
+
+template <class T>
+using ArenaPtr = std::unique_ptr<T, ArenaDelete>;
+
+// Monotonic memory owned by a Scene. Surfaces, lights and geometry buffers are carved out of
+// large blocks instead of one heap allocation each, and all of it is freed at once when the
+// scene is destroyed. Not thread-safe: allocate from the parsing thread only.
+class SceneArena {
+public:
+  explicit SceneArena(size_t initialBytes = size_t{1} << 16) : resource_(initialBytes) {}
+
+  SceneArena(const SceneArena &) = delete;
+  SceneArena &operator=(const SceneArena &) = delete;
+
+  template <class T, class... Args>
+  ArenaPtr<T> make(Args &&...args) {
+    void *p = resource_.allocate(sizeof(T), alignof(T));
+    return ArenaPtr<T>(new (p) T(std::forward<Args>(args)...));
+  }
+
+  // for std::pmr containers that live as long as the scene
+  std::pmr::memory_resource *resource() {
+    return &resource_;
+  }
+
+private:
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HIT_H
+#define HIT_H
+
+#include <cstdint>
+
+#include "math/vec3.h"
+
+class Surface;
+class Material;
+
+// Result of a closest-hit query. Only what is needed to identify the hit is stored,
+// shading attributes are evaluated once for the final hit via Surface::interaction().
+struct Hit {
+  float t = 0.f;
+  const Surface *surface = nullptr;
+  uint32_t primId = 0; // triangle index for meshes
+  float b1 = 0.f;      // barycentrics of v1/v2 (meshes)
+  float b2 = 0.f;
+};
+
+// Shading attributes at a hit point
+struct SurfaceInteraction {
+  Vec3 point{};
+  Vec3 normal{}; // normalized, not flipped towards the viewer
+  Vec3 uv{};
+  // texture coordinate units per world unit around the point, 0 if unknown
+  float uvScale = 0.f;
+  const Material *material = nullptr;
+};
+
+#endif
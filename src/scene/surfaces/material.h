@@ -2,6 +2,8 @@
 #define MATERIAL_H
 
 #include "math/color.h"
+#include "scene/textures/texture.h"
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -28,10 +30,20 @@ public:
   void setColor(const Color &c) { color_ = c; }
   const Color &color() const { return color_; }
 
-  // For textured materials: store the referenced filename (loading can be done elsewhere).
+  // For textured materials: store the referenced filename, the decoded texture is shared
+  // through the scene's TextureManager.
   void setTextureName(std::string name) { textureName_ = std::move(name); }
   const std::string &textureName() const { return textureName_; }
 
+  void setTexture(std::shared_ptr<const Texture> texture) { texture_ = std::move(texture); }
+  const Texture *texture() const { return texture_.get(); }
+
+  // color at texture coordinate uv: the color modulated by the texture if there is one,
+  // sampled at mip level 'lod'
+  Color baseColor(float u, float v, float lod = 0.f) const {
+    return texture_ ? color_ * texture_->sample(u, v, lod) : color_;
+  }
+
   void setPhong(const PhongParams &p) { phong_ = p; }
   const PhongParams &phong() const { return phong_; }
 
@@ -48,6 +60,7 @@ private:
 
   Color color_{1.f, 1.f, 1.f}; // <color r g b>
   std::string textureName_{};  // <texture name="..."> (nur wenn textured)
+  std::shared_ptr<const Texture> texture_;
 
   PhongParams phong_{}; // <phong ka kd ks exponent>
 
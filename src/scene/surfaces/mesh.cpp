@@ -0,0 +1,53 @@
+#include "scene/surfaces/mesh.h"
+
+#include <cmath>
+
+void Mesh::setTrianglePrimitives(std::pmr::vector<TrianglePrimitive> trianglePrimitives) {
+  trianglePrimitives_ = std::move(trianglePrimitives);
+  bvh_.build(trianglePrimitives_);
+}
+
+bool Mesh::intersect(Ray &ray, Hit &hit) const {
+  TriangleHit th;
+  if (!bvh_.intersect(trianglePrimitives_, ray, th))
+    return false;
+  hit.t = th.t;
+  hit.surface = this;
+  hit.primId = th.primId;
+  hit.b1 = th.b1;
+  hit.b2 = th.b2;
+  return true;
+}
+
+bool Mesh::occluded(const Ray &ray, uint32_t &primId) const {
+  return bvh_.occluded(trianglePrimitives_, ray, primId);
+}
+
+bool Mesh::occludedBy(const Ray &ray, uint32_t primId) const {
+  float t, b1, b2;
+  return intersectTriangle(trianglePrimitives_[primId], ray, t, b1, b2);
+}
+
+SurfaceInteraction Mesh::interaction(const Ray &ray, const Hit &hit) const {
+  const TrianglePrimitive &tri = trianglePrimitives_[hit.primId];
+  const float b0 = 1.f - hit.b1 - hit.b2;
+
+  SurfaceInteraction si;
+  si.point = ray.at(hit.t);
+  si.uv = tri.uv0 * b0 + tri.uv1 * hit.b1 + tri.uv2 * hit.b2;
+  si.material = &material_;
+
+  // OBJ files without normals leave zero vectors, fall back to the geometric normal
+  const Vec3 geometric = cross(tri.v1 - tri.v0, tri.v2 - tri.v0);
+  Vec3 n = tri.n0 * b0 + tri.n1 * hit.b1 + tri.n2 * hit.b2;
+  if (n.lengthSquared() < 1e-12f)
+    n = geometric;
+  si.normal = n.normalized();
+
+  // ratio of the triangle's texture space and world space areas
+  const Vec3 du = tri.uv1 - tri.uv0, dv = tri.uv2 - tri.uv0;
+  const float uvArea = std::fabs(du.x * dv.y - du.y * dv.x);
+  const float worldArea = geometric.length();
+  si.uvScale = worldArea > 0.f ? std::sqrt(uvArea / worldArea) : 0.f;
+  return si;
+}
@@ -2,7 +2,9 @@
 #define MESH_H
 
 #include "math/vec3.h"
+#include "scene/accel/bvh.h"
 #include "scene/surfaces/surface.h"
+#include <memory_resource>
 #include <ostream>
 #include <vector>
 
@@ -12,21 +14,46 @@ struct TrianglePrimitive {
   Vec3 uv0, uv1, uv2;
 };
 
+// Triangle mesh, vertices are stored in world space (transforms are baked in by the parser)
 class Mesh : public Surface {
 public:
+  // triangles and BVH nodes are allocated from 'resource', the parser passes the scene arena
+  explicit Mesh(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : trianglePrimitives_(resource), bvh_(resource) {}
+
   SurfaceType type() const override {
     return SurfaceType::MESH;
   }
-  void setTrianglePrimitives(std::vector<TrianglePrimitive> trianglePrimitives) {
+
+  bool intersect(Ray &ray, Hit &hit) const override;
+  bool occluded(const Ray &ray, uint32_t &primId) const override;
+  bool occludedBy(const Ray &ray, uint32_t primId) const override;
+  SurfaceInteraction interaction(const Ray &ray, const Hit &hit) const override;
+  Bounds3 worldBounds() const override {
+    return bvh_.bounds();
+  }
+
+  // Takes ownership of the triangles and builds the BVH (which reorders them). The buffer is
+  // adopted without a copy if it uses the mesh's memory resource.
+  void setTrianglePrimitives(std::pmr::vector<TrianglePrimitive> trianglePrimitives);
+
+  // Takes triangles already in BVH order together with the nodes built for them (scene snapshots)
+  void setPrebuilt(std::pmr::vector<TrianglePrimitive> trianglePrimitives, const BVHNode *nodes, size_t nodeCount) {
     trianglePrimitives_ = std::move(trianglePrimitives);
+    bvh_.assign(nodes, nodeCount);
   }
 
-  const std::vector<TrianglePrimitive>& triangles() const {
+  const std::pmr::vector<TrianglePrimitive>& triangles() const {
   return trianglePrimitives_;
 }
 
+  const TriangleBVH &bvh() const {
+    return bvh_;
+  }
+
 private:
-  std::vector<TrianglePrimitive> trianglePrimitives_;
+  std::pmr::vector<TrianglePrimitive> trianglePrimitives_;
+  TriangleBVH bvh_;
 };
 
 inline std::ostream &operator<<(std::ostream &os, const Mesh &m) {
@@ -34,4 +61,4 @@ inline std::ostream &operator<<(std::ostream &os, const Mesh &m) {
   return os;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -3,6 +3,7 @@
 
 #include "math/vec3.h"
 #include "scene/surfaces/surface.h"
+#include <cmath>
 #include <ostream>
 
 class Sphere : public Surface {
@@ -10,6 +11,58 @@ public:
   SurfaceType type() const override {
     return SurfaceType::SPHERE;
   }
+
+  bool intersect(Ray &ray, Hit &hit) const override {
+    float t;
+    if (!hitDistance(ray, t))
+      return false;
+    ray.tMax = t;
+    hit.t = t;
+    hit.surface = this;
+    hit.primId = 0;
+    return true;
+  }
+
+  bool occluded(const Ray &ray, uint32_t &primId) const override {
+    float t;
+    primId = 0;
+    return hitDistance(ray, t);
+  }
+
+  bool occludedBy(const Ray &ray, uint32_t) const override {
+    float t;
+    return hitDistance(ray, t);
+  }
+
+  SurfaceInteraction interaction(const Ray &ray, const Hit &hit) const override {
+    SurfaceInteraction si;
+    si.point = ray.at(hit.t);
+    si.material = &material_;
+
+    const Vec3 local = transform_.isIdentity() ? si.point : transform_.applyInversePoint(si.point);
+    const Vec3 n = (local - centerPosition_) / radius_;
+    si.normal = transform_.isIdentity() ? n : transform_.applyNormal(n).normalized();
+
+    // spherical mapping in object space
+    constexpr float kPi = 3.14159265358979323846f;
+    si.uv = {0.5f + std::atan2(n.x, n.z) / (2.f * kPi), 0.5f + std::asin(std::fmax(-1.f, std::fmin(1.f, n.y))) / kPi, 0.f};
+    // u spans 2 pi r and v spans pi r: geometric mean of both rates
+    const float r = transform_.isIdentity() ? radius_ : transform_.applyVector(n * radius_).length();
+    si.uvScale = r > 0.f ? 1.f / (kPi * std::sqrt(2.f) * r) : 0.f;
+    return si;
+  }
+
+  Bounds3 worldBounds() const override {
+    Bounds3 b;
+    for (int i = 0; i < 8; ++i) {
+      const Vec3 corner{centerPosition_.x + ((i & 1) ? radius_ : -radius_),
+                        centerPosition_.y + ((i & 2) ? radius_ : -radius_),
+                        centerPosition_.z + ((i & 4) ? radius_ : -radius_)};
+      b.expand(transform_.applyPoint(corner));
+    }
+    return b;
+  }
+
   void setCenterPosition(const Vec3 &centerPosition) {
     centerPosition_ = centerPosition;
   }
@@ -26,6 +79,33 @@ public:
   }
 
 private:
+  // Ray/sphere test in object space, the direction is not renormalized so t stays a world space parameter
+  bool hitDistance(const Ray &ray, float &tOut) const {
+    Vec3 o = ray.origin, d = ray.direction;
+    if (!transform_.isIdentity()) {
+      o = transform_.applyInversePoint(o);
+      d = transform_.applyInverseVector(d);
+    }
+
+    const Vec3 oc = o - centerPosition_;
+    const float a = dot(d, d);
+    const float halfB = dot(oc, d);
+    const float c = dot(oc, oc) - radius_ * radius_;
+    const float disc = halfB * halfB - a * c;
+    if (disc < 0.f)
+      return false;
+
+    const float sq = std::sqrt(disc);
+    float t = (-halfB - sq) / a;
+    if (t <= ray.tMin || t >= ray.tMax) {
+      t = (-halfB + sq) / a;
+      if (t <= ray.tMin || t >= ray.tMax)
+        return false;
+    }
+    tOut = t;
+    return true;
+  }
+
   Vec3 centerPosition_{0, 0, 0};
   float radius_ = 1.f;
 };
@@ -35,4 +115,4 @@ inline std::ostream& operator<<(std::ostream& os, const Sphere& s) {
   return os;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,9 @@
 #ifndef SURFACE_H
 #define SURFACE_H
 
+#include "math/bounds3.h"
+#include "math/ray.h"
+#include "scene/surfaces/hit.h"
 #include "scene/surfaces/material.h"
 #include "scene/surfaces/transform.h"
 
@@ -13,6 +16,18 @@ class Surface {
 public:
   virtual ~Surface() = default;
   virtual SurfaceType type() const = 0; 
+
+  // Closest-hit query: on a closer hit 'hit' is filled and ray.tMax is shortened to it
+  virtual bool intersect(Ray &ray, Hit &hit) const = 0;
+  // Any-hit query for shadow rays: true on the first intersection in (tMin, tMax), no attributes
+  // except the primitive that was hit
+  virtual bool occluded(const Ray &ray, uint32_t &primId) const = 0;
+  // Any-hit query against a single primitive reported by occluded()
+  virtual bool occludedBy(const Ray &ray, uint32_t primId) const = 0;
+  // Evaluates point/normal/uv for a hit previously returned by intersect()
+  virtual SurfaceInteraction interaction(const Ray &ray, const Hit &hit) const = 0;
+  virtual Bounds3 worldBounds() const = 0;
+
   void setMaterial(Material material) {
     material_ = std::move(material);
   }
@@ -20,9 +35,16 @@ public:
     transform_ = transform;
   }
 
+  const Material &material() const {
+    return material_;
+  }
+  const Transform &transform() const {
+    return transform_;
+  }
+
 protected:
   Material material_;
   Transform transform_;
 };
 
-#endif
\ No newline at end of file
+#endif
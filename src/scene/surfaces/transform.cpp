@@ -83,6 +83,7 @@ void Transform::rotateZ(float deg) {
 }
 
 void Transform::recomputeCaches() {
+  identity_ = false;
   invM_ = inverseAffine(M_);
 
   // normal matrix = transpose(inverse(upper-left 3x3))
@@ -109,3 +110,13 @@ Vec3 Transform::applyNormal(const Vec3 &n) const {
       normalM_.m[2][0] * n.x + normalM_.m[2][1] * n.y + normalM_.m[2][2] * n.z};
   return r;
 }
+
+Vec3 Transform::applyInversePoint(const Vec3 &p) const {
+  Vec4 hp = mul(invM_, Vec4{p.x, p.y, p.z, 1.f});
+  return {hp.x, hp.y, hp.z};
+}
+
+Vec3 Transform::applyInverseVector(const Vec3 &v) const {
+  Vec4 hv = mul(invM_, Vec4{v.x, v.y, v.z, 0.f});
+  return {hv.x, hv.y, hv.z};
+}
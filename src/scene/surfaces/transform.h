@@ -23,6 +23,12 @@ public:
   Vec3 applyPoint(const Vec3 &p) const;
   Vec3 applyVector(const Vec3 &v) const;
   Vec3 applyNormal(const Vec3 &n) const;
+  // world -> object space, used to intersect rays with transformed implicit surfaces
+  Vec3 applyInversePoint(const Vec3 &p) const;
+  Vec3 applyInverseVector(const Vec3 &v) const;
+
+  // true as long as no operation has been applied
+  bool isIdentity() const { return identity_; }
 
 private:
   void recomputeCaches(); // inv + normal matrix
@@ -30,6 +36,7 @@ private:
   Mat4 M_;
   Mat4 invM_;
   Mat3 normalM_;
+  bool identity_ = true;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef TEXEL_FILTER_H
+#define TEXEL_FILTER_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "math/color.h"
+
+#if defined(__SSE2__) && !defined(RAYTRACER_NO_SIMD)
+#include <emmintrin.h>
+#define TEXEL_FILTER_SSE2 1
+#endif
+
+// Bilinear blend of four RGBA8 texels (t00 top left, t10 top right, t01 bottom left,
+// t11 bottom right) with fractions tx, ty, result in [0, 1]. With SSE2 all four channels
+// are widened, converted and blended at once in one register per texel.
+inline Color filterTexels(const uint8_t *t00, const uint8_t *t10, const uint8_t *t01, const uint8_t *t11, float tx,
+                          float ty) {
+  constexpr float kInv = 1.f / 255.f;
+#ifdef TEXEL_FILTER_SSE2
+  auto load = [](const uint8_t *t) {
+    int32_t v;
+    std::memcpy(&v, t, 4);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128(v);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+  };
+  const __m128 wx = _mm_set1_ps(tx), wy = _mm_set1_ps(ty);
+  const __m128 c00 = load(t00), c10 = load(t10), c01 = load(t01), c11 = load(t11);
+  // lerp(a, b, t) = a + (b - a) * t
+  const __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), wx));
+  const __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), wx));
+  const __m128 c = _mm_mul_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy)), _mm_set1_ps(kInv));
+  alignas(16) float out[4];
+  _mm_store_ps(out, c);
+  return {out[0], out[1], out[2]};
+#else
+  const float w00 = (1.f - tx) * (1.f - ty), w10 = tx * (1.f - ty), w01 = (1.f - tx) * ty, w11 = tx * ty;
+  return Color{t00[0] * w00 + t10[0] * w10 + t01[0] * w01 + t11[0] * w11,
+               t00[1] * w00 + t10[1] * w10 + t01[1] * w01 + t11[1] * w11,
+               t00[2] * w00 + t10[2] * w10 + t01[2] * w01 + t11[2] * w11} *
+         kInv;
+#endif
+}
+
+#endif
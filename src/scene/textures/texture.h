@@ -0,0 +1,236 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "math/color.h"
+#include "scene/textures/texel_filter.h"
+
+// Memory order of the texels of a mip level
+enum class TextureLayout {
+  ROW_MAJOR, // scanlines, a 2x2 bilinear footprint spans two rows far apart
+  TILED,     // 4x4 texel tiles of one 64 byte cache line each, tiles in row-major order
+  Z_ORDER    // Morton order inside 16x16 texel blocks, blocks in row-major order
+};
+
+class PagedTexture;
+
+// bilinear lookup on a texture paged in from a tile file (texture_cache.cpp)
+Color samplePaged(const PagedTexture &paged, int level, float u, float v);
+
+// Decoded 8 bit RGBA texture with its mip pyramid, texel (0, 0) is the top left corner.
+// Texture coordinates repeat, v = 0 is the bottom edge as in OBJ files.
+// The texels are either held in memory or paged in on demand (setPaged()).
+class Texture {
+public:
+  explicit Texture(std::string name, TextureLayout layout = TextureLayout::TILED)
+      : name_(std::move(name)), layout_(layout) {}
+
+  TextureLayout layout() const { return layout_; }
+
+  const std::string &name() const { return name_; }
+  int width() const { return paged_ ? pagedWidth_ : levels_.empty() ? 0 : levels_[0].width; }
+  int height() const { return paged_ ? pagedHeight_ : levels_.empty() ? 0 : levels_[0].height; }
+  int levelCount() const { return paged_ ? pagedLevels_ : static_cast<int>(levels_.size()); }
+  bool loaded() const { return paged_ || !levels_.empty(); }
+
+  int levelWidth(int level) const { return levels_[level].width; }
+  int levelHeight(int level) const { return levels_[level].height; }
+  // RGBA bytes of an in-memory texel, no wrapping
+  const uint8_t *texelBytes(int level, int x, int y) const { return levels_[level].at(x, y); }
+
+  bool paged() const { return paged_ != nullptr; }
+
+  // raw texels of an in-memory level in the texture's layout (scene snapshots)
+  const uint8_t *levelData(int level) const { return levels_[level].texels.data(); }
+  size_t levelBytes(int level) const { return levels_[level].texels.size(); }
+
+  // appends a level from texels already in the texture's layout, false if 'bytes' does not
+  // match the size of such a level
+  bool appendLevel(int width, int height, const uint8_t *texels, size_t bytes) {
+    Level l = makeLevel(width, height);
+    if (l.texels.size() != bytes)
+      return false;
+    std::copy_n(texels, bytes, l.texels.data());
+    levels_.push_back(std::move(l));
+    return true;
+  }
+
+  // switches to texels paged in from a tile file, drops the in-memory levels
+  void setPaged(std::shared_ptr<const PagedTexture> paged, int width, int height, int levelCount) {
+    levels_.clear();
+    levels_.shrink_to_fit();
+    paged_ = std::move(paged);
+    pagedWidth_ = width;
+    pagedHeight_ = height;
+    pagedLevels_ = levelCount;
+  }
+
+  // sets level 0 from row-major RGBA texels and drops all other levels
+  void setTexels(int width, int height, const std::vector<uint8_t> &rgba) {
+    levels_.clear();
+    levels_.push_back(makeLevel(width, height));
+    Level &l = levels_.back();
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+        std::copy_n(&rgba[(static_cast<size_t>(y) * width + x) * 4], 4, l.at(x, y));
+  }
+
+  // builds levels 1..n down to 1x1 with a 2x2 box filter
+  void generateMips() {
+    levels_.resize(1);
+    while (levels_.back().width > 1 || levels_.back().height > 1) {
+      Level dst = makeLevel(std::max(1, levels_.back().width / 2), std::max(1, levels_.back().height / 2));
+      const Level &src = levels_.back();
+      for (int y = 0; y < dst.height; ++y) {
+        const int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+        for (int x = 0; x < dst.width; ++x) {
+          const int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+          for (int c = 0; c < 4; ++c) {
+            const int sum = src.at(x0, y0)[c] + src.at(x1, y0)[c] + src.at(x0, y1)[c] + src.at(x1, y1)[c];
+            dst.at(x, y)[c] = static_cast<uint8_t>((sum + 2) / 4);
+          }
+        }
+      }
+      levels_.push_back(std::move(dst));
+    }
+  }
+
+  // resident texel memory, paged textures are accounted by their cache
+  size_t memoryBytes() const {
+    size_t bytes = 0;
+    for (const Level &l : levels_)
+      bytes += l.texels.size();
+    return bytes;
+  }
+
+  // texel color in [0, 1], x and y are wrapped into the level
+  Color texel(int level, int x, int y) const {
+    const Level &l = levels_[level];
+    const uint8_t *t = l.at(wrap(x, l.width), wrap(y, l.height));
+    constexpr float kInv = 1.f / 255.f;
+    return {t[0] * kInv, t[1] * kInv, t[2] * kInv};
+  }
+
+  // Trilinear filtered color at (u, v): bilinear on the two levels around 'lod', blended.
+  // lod 0 is the full resolution, every further unit halves it.
+  Color sample(float u, float v, float lod = 0.f) const {
+    if (!loaded())
+      return {1.f, 1.f, 1.f};
+    lod = std::min(std::max(lod, 0.f), static_cast<float>(levelCount() - 1));
+    const int level = static_cast<int>(lod);
+    const float t = lod - static_cast<float>(level);
+    const Color fine = bilinear(level, u, v);
+    if (t <= 0.f)
+      return fine;
+    return fine * (1.f - t) + bilinear(level + 1, u, v) * t;
+  }
+
+private:
+  struct Level {
+    int width;
+    int height;
+    TextureLayout layout;
+    int blocksX; // tiles/blocks per row, width padded to whole blocks
+    std::vector<uint8_t> texels;
+
+    template <TextureLayout L>
+    size_t index(int x, int y) const {
+      if (L == TextureLayout::TILED)
+        return (static_cast<size_t>(y >> 2) * blocksX + (x >> 2)) * 16 + ((y & 3) << 2) + (x & 3);
+      if (L == TextureLayout::Z_ORDER)
+        return (static_cast<size_t>(y >> 4) * blocksX + (x >> 4)) * 256 + morton(x & 15, y & 15);
+      return static_cast<size_t>(y) * width + x;
+    }
+
+    size_t index(int x, int y) const {
+      switch (layout) {
+      case TextureLayout::TILED:
+        return index<TextureLayout::TILED>(x, y);
+      case TextureLayout::Z_ORDER:
+        return index<TextureLayout::Z_ORDER>(x, y);
+      default:
+        return index<TextureLayout::ROW_MAJOR>(x, y);
+      }
+    }
+
+    uint8_t *at(int x, int y) { return &texels[index(x, y) * 4]; }
+    const uint8_t *at(int x, int y) const { return &texels[index(x, y) * 4]; }
+  };
+
+  // interleaves the bits of two 4 bit coordinates
+  static unsigned morton(unsigned x, unsigned y) {
+    auto spread = [](unsigned v) {
+      v = (v | (v << 2)) & 0x33u;
+      return (v | (v << 1)) & 0x55u;
+    };
+    return spread(x) | (spread(y) << 1);
+  }
+
+  Level makeLevel(int width, int height) const {
+    Level l{width, height, layout_, width, {}};
+    size_t texels = static_cast<size_t>(width) * height;
+    if (layout_ == TextureLayout::TILED) {
+      l.blocksX = (width + 3) / 4;
+      texels = static_cast<size_t>(l.blocksX) * ((height + 3) / 4) * 16;
+    } else if (layout_ == TextureLayout::Z_ORDER) {
+      l.blocksX = (width + 15) / 16;
+      texels = static_cast<size_t>(l.blocksX) * ((height + 15) / 16) * 256;
+    }
+    l.texels.assign(texels * 4, 0);
+    return l;
+  }
+
+  // the layout is dispatched once per lookup instead of once per texel
+  Color bilinear(int level, float u, float v) const {
+    if (paged_)
+      return samplePaged(*paged_, level, u, v);
+    switch (layout_) {
+    case TextureLayout::TILED:
+      return bilinear<TextureLayout::TILED>(levels_[level], u, v);
+    case TextureLayout::Z_ORDER:
+      return bilinear<TextureLayout::Z_ORDER>(levels_[level], u, v);
+    default:
+      return bilinear<TextureLayout::ROW_MAJOR>(levels_[level], u, v);
+    }
+  }
+
+  template <TextureLayout L>
+  static Color bilinear(const Level &l, float u, float v) {
+    const float x = u * l.width - 0.5f;
+    const float y = (1.f - v) * l.height - 0.5f;
+    const float fx = std::floor(x), fy = std::floor(y);
+    const float tx = x - fx, ty = y - fy;
+    // wrap once per axis, the second column/row wraps around at the edge
+    const int x0 = wrap(static_cast<int>(fx), l.width), y0 = wrap(static_cast<int>(fy), l.height);
+    const int x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+    const int y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+
+    const uint8_t *t = l.texels.data();
+    const uint8_t *t00 = t + l.template index<L>(x0, y0) * 4, *t10 = t + l.template index<L>(x1, y0) * 4;
+    const uint8_t *t01 = t + l.template index<L>(x0, y1) * 4, *t11 = t + l.template index<L>(x1, y1) * 4;
+    return filterTexels(t00, t10, t01, t11, tx, ty);
+  }
+
+  static int wrap(int i, int n) {
+    if (i >= 0 && i < n)
+      return i;
+    i %= n;
+    return i < 0 ? i + n : i;
+  }
+
+  std::string name_;
+  TextureLayout layout_;
+  std::vector<Level> levels_;
+  std::shared_ptr<const PagedTexture> paged_;
+  int pagedWidth_ = 0;
+  int pagedHeight_ = 0;
+  int pagedLevels_ = 0;
+};
+
+#endif
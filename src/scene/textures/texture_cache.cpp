@@ -0,0 +1,253 @@
+#include "scene/textures/texture_cache.h"
+
+#include "util/heap_guard.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[4] = {'R', 'T', 'T', 'X'};
+
+int wrap(int i, int n) {
+  if (i >= 0 && i < n)
+    return i;
+  i %= n;
+  return i < 0 ? i + n : i;
+}
+
+// 20 bits file id, 6 bits level, 19 bits per tile coordinate
+uint64_t tileKey(uint32_t fileId, int level, int tx, int ty) {
+  return (uint64_t(fileId) << 44) | (uint64_t(level) << 38) | (uint64_t(ty) << 19) | uint64_t(tx);
+}
+
+std::atomic<size_t> nextHitCounter{0};
+
+// The last tiles the thread looked up, of any cache, replaced round robin
+struct TileMemo {
+  struct Slot {
+    uint64_t generation = 0; // 0: empty
+    uint64_t key = 0;
+    TextureTileCache::Tile tile;
+  };
+  Slot slots[TextureTileCache::kMemoSlots];
+  int next = 0;
+  // the thread's memo hit counter, assigned on first use so that the cache does not depend on
+  // TaskScheduler (texture_bench links it alone)
+  size_t hitCounter = nextHitCounter.fetch_add(1, std::memory_order_relaxed);
+};
+
+thread_local TileMemo tlsMemo;
+std::atomic<uint64_t> nextGeneration{1};
+
+} // namespace
+
+TileFile::~TileFile() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool TileFile::write(const std::string &path, const Texture &texture, std::string &outError) {
+  // checked before anything is written, open() and the cache keys rely on these bounds
+  if (texture.levelCount() > kMaxLevels ||
+      (texture.levelWidth(0) + kTileSize - 1) / kTileSize > kMaxTilesPerAxis ||
+      (texture.levelHeight(0) + kTileSize - 1) / kTileSize > kMaxTilesPerAxis) {
+    outError = "Texture " + texture.name() + " is too large for the tile cache.";
+    return false;
+  }
+
+  std::FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    outError = "Could not open " + path + " for writing.";
+    return false;
+  }
+
+  const uint32_t header[3] = {kVersion, kTileSize, static_cast<uint32_t>(texture.levelCount())};
+  std::fwrite(kMagic, 1, 4, f);
+  std::fwrite(header, sizeof(uint32_t), 3, f);
+
+  std::vector<LevelInfo> levels;
+  uint64_t offset = 16 + sizeof(LevelInfo) * static_cast<uint64_t>(texture.levelCount());
+  for (int level = 0; level < texture.levelCount(); ++level) {
+    LevelInfo info{texture.levelWidth(level), texture.levelHeight(level), 0, 0, offset};
+    info.tilesX = (info.width + kTileSize - 1) / kTileSize;
+    info.tilesY = (info.height + kTileSize - 1) / kTileSize;
+    offset += tileBytes() * static_cast<uint64_t>(info.tilesX) * info.tilesY;
+    levels.push_back(info);
+  }
+  std::fwrite(levels.data(), sizeof(LevelInfo), levels.size(), f);
+
+  std::vector<uint8_t> tile(tileBytes());
+  bool ok = true;
+  for (int level = 0; level < texture.levelCount() && ok; ++level) {
+    const LevelInfo &info = levels[level];
+    for (int ty = 0; ty < info.tilesY && ok; ++ty) {
+      for (int tx = 0; tx < info.tilesX && ok; ++tx) {
+        std::fill(tile.begin(), tile.end(), 0);
+        for (int y = 0; y < kTileSize && ty * kTileSize + y < info.height; ++y)
+          for (int x = 0; x < kTileSize && tx * kTileSize + x < info.width; ++x)
+            std::memcpy(&tile[(static_cast<size_t>(y) * kTileSize + x) * 4],
+                        texture.texelBytes(level, tx * kTileSize + x, ty * kTileSize + y), 4);
+        ok = std::fwrite(tile.data(), 1, tile.size(), f) == tile.size();
+      }
+    }
+  }
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok)
+    outError = "Write to " + path + " failed.";
+  return ok;
+}
+
+bool TileFile::open(const std::string &path, std::string &outError) {
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    outError = "Could not open " + path + ".";
+    return false;
+  }
+  char magic[4];
+  uint32_t header[3];
+  if (::pread(fd_, magic, 4, 0) != 4 || ::pread(fd_, header, sizeof(header), 4) != sizeof(header) ||
+      std::memcmp(magic, kMagic, 4) != 0 || header[0] != kVersion || header[1] != static_cast<uint32_t>(kTileSize) ||
+      header[2] == 0 || header[2] > static_cast<uint32_t>(kMaxLevels)) {
+    outError = path + " is not a tile file of this version.";
+    return false;
+  }
+  levels_.resize(header[2]);
+  const ssize_t infoBytes = static_cast<ssize_t>(sizeof(LevelInfo) * levels_.size());
+  if (::pread(fd_, levels_.data(), static_cast<size_t>(infoBytes), 16) != infoBytes) {
+    outError = path + ": truncated header.";
+    return false;
+  }
+  return true;
+}
+
+bool TileFile::readTile(int level, int tx, int ty, uint8_t *out) const {
+  const LevelInfo &info = levels_[level];
+  const off_t offset = static_cast<off_t>(info.offset + tileBytes() * (static_cast<uint64_t>(ty) * info.tilesX + tx));
+  return ::pread(fd_, out, tileBytes(), offset) == static_cast<ssize_t>(tileBytes());
+}
+
+TextureTileCache::TextureTileCache(size_t budgetBytes)
+    : generation_(nextGeneration.fetch_add(1, std::memory_order_relaxed)), budget_(budgetBytes), shardBudget_(std::max(budgetBytes / kShards, TileFile::tileBytes())) {}
+
+TextureTileCache::Tile TextureTileCache::tile(const TileFile &file, uint32_t fileId, int level, int tx, int ty) {
+  const uint64_t key = tileKey(fileId, level, tx, ty);
+  Shard &shard = shards_[(key * 0x9e3779b97f4a7c15ull) >> 58];
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lruPos);
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      return it->second.tile;
+    }
+  }
+
+  // read without holding the shard, another thread may load the same tile meanwhile.
+  // Resident tiles are heap allocated, misses are expected inside the render loop.
+  HeapPermit paging;
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  auto data = std::make_shared<std::vector<uint8_t>>(TileFile::tileBytes());
+  if (!file.readTile(level, tx, ty, data->data())) {
+    readErrors_.fetch_add(1, std::memory_order_relaxed);
+    std::fill(data->begin(), data->end(), 0);
+  }
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end())
+    return it->second.tile;
+
+  shard.lru.push_front(key);
+  shard.entries.emplace(key, Entry{data, shard.lru.begin()});
+  shard.bytes += data->size();
+  const size_t resident = resident_.fetch_add(data->size(), std::memory_order_relaxed) + data->size();
+  size_t peak = peak_.load(std::memory_order_relaxed);
+  while (resident > peak && !peak_.compare_exchange_weak(peak, resident, std::memory_order_relaxed)) {
+  }
+
+  // evict least recently used tiles, the new tile always stays
+  while (shard.bytes > shardBudget_ && shard.lru.size() > 1) {
+    const uint64_t victim = shard.lru.back();
+    shard.lru.pop_back();
+    auto v = shard.entries.find(victim);
+    shard.bytes -= v->second.tile->size();
+    resident_.fetch_sub(v->second.tile->size(), std::memory_order_relaxed);
+    shard.entries.erase(v);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return data;
+}
+
+const uint8_t *TextureTileCache::texels(const TileFile &file, uint32_t fileId, int level, int tx, int ty) {
+  const uint64_t key = tileKey(fileId, level, tx, ty);
+  TileMemo &memo = tlsMemo;
+  for (const TileMemo::Slot &slot : memo.slots) {
+    if (slot.key == key && slot.generation == generation_) {
+      memoHits_[memo.hitCounter % kHitCounters].count.fetch_add(1, std::memory_order_relaxed);
+      return slot.tile->data();
+    }
+  }
+
+  TileMemo::Slot &slot = memo.slots[memo.next];
+  memo.next = (memo.next + 1) % kMemoSlots;
+  slot.tile = tile(file, fileId, level, tx, ty);
+  slot.key = key;
+  slot.generation = generation_;
+  return slot.tile->data();
+}
+
+TextureTileCache::Stats TextureTileCache::stats() const {
+  Stats s;
+  s.hits = hits_.load();
+  for (const HitCounter &counter : memoHits_)
+    s.hits += counter.count.load();
+  s.misses = misses_.load();
+  s.evictions = evictions_.load();
+  s.readErrors = readErrors_.load();
+  s.residentBytes = resident_.load();
+  s.peakBytes = peak_.load();
+  return s;
+}
+
+Color PagedTexture::bilinear(int level, float u, float v) const {
+  constexpr int kTile = TileFile::kTileSize;
+  const int width = file_->width(level), height = file_->height(level);
+  const float x = u * width - 0.5f;
+  const float y = (1.f - v) * height - 0.5f;
+  const float fx = std::floor(x), fy = std::floor(y);
+  const float tx = x - fx, ty = y - fy;
+  const int x0 = wrap(static_cast<int>(fx), width), y0 = wrap(static_cast<int>(fy), height);
+  const int xs[2] = {x0, x0 + 1 == width ? 0 : x0 + 1};
+  const int ys[2] = {y0, y0 + 1 == height ? 0 : y0 + 1};
+
+  // the 2x2 footprint touches one tile unless it straddles a tile edge, every distinct
+  // tile is fetched once; at most four lookups keep all of them valid (kMemoSlots)
+  static_assert(TextureTileCache::kMemoSlots >= 4, "the footprint needs four valid tiles");
+  const int tileXs[2] = {xs[0] / kTile, xs[1] / kTile};
+  const int tileYs[2] = {ys[0] / kTile, ys[1] / kTile};
+  const uint8_t *tiles[2][2];
+  const uint8_t *texels[2][2];
+  for (int j = 0; j < 2; ++j) {
+    for (int i = 0; i < 2; ++i) {
+      const uint8_t *&t = tiles[j][i];
+      if (i == 1 && tileXs[1] == tileXs[0])
+        t = tiles[j][0];
+      else if (j == 1 && tileYs[1] == tileYs[0])
+        t = tiles[0][i];
+      else
+        t = cache_.texels(*file_, id_, level, tileXs[i], tileYs[j]);
+      texels[j][i] = t + (static_cast<size_t>(ys[j] % kTile) * kTile + xs[i] % kTile) * 4;
+    }
+  }
+  return filterTexels(texels[0][0], texels[0][1], texels[1][0], texels[1][1], tx, ty);
+}
+
+Color samplePaged(const PagedTexture &paged, int level, float u, float v) {
+  return paged.bilinear(level, u, v);
+}
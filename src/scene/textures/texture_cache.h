@@ -0,0 +1,149 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "math/color.h"
+#include "scene/textures/texture.h"
+
+// Pre-converted copy of a texture and all its mip levels, split into square tiles of
+// kTileSize^2 RGBA texels (row-major inside a tile, edge tiles padded). Tiles are read
+// individually with pread, so one file can be shared by all render threads.
+// Layout: header "RTTX", version, tile size, level count, then per level width, height
+// and the file offset of its first tile, then the tiles of every level row by row.
+// Numbers are stored in host byte order, the file is a local cache and not portable.
+class TileFile {
+public:
+  static constexpr int kTileSize = 64;
+  static constexpr uint32_t kVersion = 1;
+  // bounds of the cache keys (level, tile coordinates), 2^19 tiles are 32M texels per axis
+  static constexpr int kMaxLevels = 32;
+  static constexpr int kMaxTilesPerAxis = 1 << 19;
+
+  TileFile() = default;
+  TileFile(const TileFile &) = delete;
+  TileFile &operator=(const TileFile &) = delete;
+  ~TileFile();
+
+  // Writes all levels of an in-memory texture to 'path'
+  static bool write(const std::string &path, const Texture &texture, std::string &outError);
+
+  bool open(const std::string &path, std::string &outError);
+
+  int levelCount() const { return static_cast<int>(levels_.size()); }
+  int width(int level) const { return levels_[level].width; }
+  int height(int level) const { return levels_[level].height; }
+  int tilesX(int level) const { return levels_[level].tilesX; }
+
+  static constexpr size_t tileBytes() { return size_t(kTileSize) * kTileSize * 4; }
+
+  // reads tile (tx, ty) of 'level' into 'out' (tileBytes() bytes)
+  bool readTile(int level, int tx, int ty, uint8_t *out) const;
+
+private:
+  struct LevelInfo {
+    int32_t width;
+    int32_t height;
+    int32_t tilesX;
+    int32_t tilesY;
+    uint64_t offset;
+  };
+
+  int fd_ = -1;
+  std::vector<LevelInfo> levels_;
+};
+
+// Tiles of paged textures resident in memory, bounded by a byte budget. The cache is split
+// into shards by tile key, every shard has its own lock, LRU list and share of the budget,
+// so render threads rarely contend. Tiles are handed out as shared pointers: an evicted tile
+// stays valid for the threads still filtering from it. Misses are read outside the lock.
+// In front of the shards every thread memoizes its last few tiles, texel lookups that hit
+// the memo take no lock and touch no reference count. Memo hits do not refresh the LRU
+// order, and memoized tiles outlive their eviction by at most kMemoSlots tiles per thread.
+class TextureTileCache {
+public:
+  using Tile = std::shared_ptr<const std::vector<uint8_t>>;
+  static constexpr int kMemoSlots = 8;
+
+  explicit TextureTileCache(size_t budgetBytes);
+
+  // tile (tx, ty) of 'level' of the file registered as 'fileId', loaded on a miss
+  Tile tile(const TileFile &file, uint32_t fileId, int level, int tx, int ty);
+  // Texels of the same tile through the calling thread's memo. The pointer stays valid for
+  // the next kMemoSlots - 1 lookups of this thread.
+  const uint8_t *texels(const TileFile &file, uint32_t fileId, int level, int tx, int ty);
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t readErrors = 0;
+    size_t residentBytes = 0;
+    size_t peakBytes = 0;
+  };
+  Stats stats() const;
+
+  size_t budgetBytes() const {
+    return budget_;
+  }
+
+private:
+  static constexpr size_t kShards = 64;
+
+  struct Entry {
+    Tile tile;
+    std::list<uint64_t>::iterator lruPos;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::list<uint64_t> lru; // most recently used first
+    size_t bytes = 0;
+  };
+
+  // memo hits, one counter per thread (modulo kHitCounters), each on its own cache line
+  static constexpr size_t kHitCounters = 64;
+  struct alignas(64) HitCounter {
+    std::atomic<uint64_t> count{0};
+  };
+
+  // tells memo entries of this cache from those of an earlier one at the same address
+  const uint64_t generation_;
+  std::array<HitCounter, kHitCounters> memoHits_;
+  size_t budget_;
+  size_t shardBudget_;
+  std::array<Shard, kShards> shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> readErrors_{0};
+  std::atomic<size_t> resident_{0};
+  std::atomic<size_t> peak_{0};
+};
+
+// Texture backed by a TileFile whose tiles are paged in through a shared TextureTileCache
+class PagedTexture {
+public:
+  PagedTexture(std::unique_ptr<TileFile> file, TextureTileCache &cache, uint32_t id)
+      : file_(std::move(file)), cache_(cache), id_(id) {}
+
+  const TileFile &file() const { return *file_; }
+
+  Color bilinear(int level, float u, float v) const;
+
+private:
+  std::unique_ptr<TileFile> file_;
+  TextureTileCache &cache_;
+  uint32_t id_;
+};
+
+#endif
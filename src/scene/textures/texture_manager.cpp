@@ -0,0 +1,104 @@
+#include "scene/textures/texture_manager.h"
+
+#include <filesystem>
+
+#include "image/image_io.h"
+#include "util/task_scheduler.h"
+
+std::string TextureManager::fileName(const std::string &name) {
+  return std::filesystem::path(name).filename().string();
+}
+
+std::shared_ptr<const Texture> TextureManager::request(const std::string &name) {
+  // "textures/brick.png" and "brick.png" load the same file and share one texture
+  const std::string file = fileName(name);
+  auto it = textures_.find(file);
+  if (it != textures_.end())
+    return it->second;
+  auto texture = std::make_shared<Texture>(file, layout_);
+  textures_.emplace(file, texture);
+  pending_.push_back(texture);
+  return texture;
+}
+
+bool TextureManager::loadPending(std::string &outError) {
+  // one task per file, large and small textures balance across the workers
+  std::vector<std::string> errors(pending_.size());
+  // tile cache ids follow the request order
+  const uint32_t firstId = static_cast<uint32_t>(textures_.size() - pending_.size());
+  TaskGroup group;
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    group.run([this, &errors, i, firstId] {
+      Texture *texture = pending_[i].get();
+      // names are bare file names, scene files cannot reach outside the texture directory
+      const std::string path = (std::filesystem::path(directory_) / texture->name()).string();
+      if (cache_) {
+        loadPaged(*texture, path, firstId + static_cast<uint32_t>(i), errors[i]);
+        return;
+      }
+      int width = 0, height = 0;
+      std::vector<uint8_t> rgba;
+      if (!imageio::readPng(path, width, height, rgba, errors[i]))
+        return;
+      texture->setTexels(width, height, rgba);
+      texture->generateMips();
+    });
+  }
+  group.wait();
+  pending_.clear();
+
+  // report the first failure in request order
+  for (const std::string &error : errors) {
+    if (!error.empty()) {
+      outError = "Texture load failed: " + error;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TextureManager::loadPaged(Texture &texture, const std::string &pngPath, uint32_t id, std::string &outError) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  fs::create_directories(cacheDirectory_, ec);
+  const fs::path tilePath = fs::path(cacheDirectory_) / (texture.name() + ".tiles");
+
+  // convert unless an up to date tile file exists
+  const bool fresh = fs::exists(tilePath, ec) && fs::exists(pngPath, ec) &&
+                     fs::last_write_time(tilePath, ec) >= fs::last_write_time(pngPath, ec);
+  auto file = std::make_unique<TileFile>();
+  std::string openError;
+  if (!fresh || !file->open(tilePath.string(), openError)) {
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgba;
+    if (!imageio::readPng(pngPath, width, height, rgba, outError))
+      return false;
+    Texture full(texture.name(), TextureLayout::ROW_MAJOR);
+    full.setTexels(width, height, rgba);
+    rgba = std::vector<uint8_t>();
+    full.generateMips();
+
+    // per texture id, a concurrent writer of the same file never shares the temporary
+    const std::string tmp = tilePath.string() + "." + std::to_string(id) + ".tmp";
+    if (!TileFile::write(tmp, full, outError))
+      return false;
+    fs::rename(tmp, tilePath, ec);
+    file = std::make_unique<TileFile>();
+    if (ec || !file->open(tilePath.string(), outError)) {
+      if (ec)
+        outError = "Could not replace " + tilePath.string() + ": " + ec.message();
+      return false;
+    }
+  }
+
+  const int width = file->width(0), height = file->height(0), levels = file->levelCount();
+  texture.setPaged(std::make_shared<PagedTexture>(std::move(file), *cache_, id), width, height, levels);
+  return true;
+}
+
+size_t TextureManager::memoryBytes() const {
+  size_t bytes = 0;
+  for (const auto &entry : textures_)
+    bytes += entry.second->memoryBytes();
+  return bytes;
+}
@@ -0,0 +1,71 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "scene/textures/texture.h"
+#include "scene/textures/texture_cache.h"
+
+// Owns the textures of a scene. Textures are named by their file name inside the texture
+// directory: every file is decoded once and the same Texture is shared by all materials
+// referencing it, whatever path the scene gives. request() hands out the (still empty) texture
+// while parsing, loadPending() then decodes all requested files in parallel and builds
+// their mip pyramids.
+// With a tile cache configured textures are not kept in memory: each one is converted once
+// into a tile file in the cache directory (reused while newer than the PNG) and its tiles
+// are paged in on demand under the cache's memory budget.
+class TextureManager {
+public:
+  explicit TextureManager(std::string directory = "../assets/textures") : directory_(std::move(directory)) {}
+
+  // memory layout of textures requested from now on
+  void setLayout(TextureLayout layout) {
+    layout_ = layout;
+  }
+
+  // page textures requested from now on through a tile cache of 'budgetBytes'
+  void setTileCache(std::string cacheDirectory, size_t budgetBytes) {
+    cacheDirectory_ = std::move(cacheDirectory);
+    cache_ = std::make_unique<TextureTileCache>(budgetBytes);
+  }
+
+  // nullptr if textures are held in memory
+  const TextureTileCache *tileCache() const {
+    return cache_.get();
+  }
+
+  std::shared_ptr<const Texture> request(const std::string &name);
+
+  // registers a texture that is already loaded (scene snapshots), replaces one of the same name
+  void add(std::shared_ptr<Texture> texture) {
+    textures_[fileName(texture->name())] = std::move(texture);
+  }
+
+  // Decodes all textures requested since the last call, false with the first error
+  bool loadPending(std::string &outError);
+
+  size_t size() const {
+    return textures_.size();
+  }
+  // texel memory of all textures including mip levels
+  size_t memoryBytes() const;
+
+private:
+  // the key and texture name of a requested name: its file name without directories
+  static std::string fileName(const std::string &name);
+
+  std::string directory_;
+  TextureLayout layout_ = TextureLayout::TILED;
+  std::unordered_map<std::string, std::shared_ptr<Texture>> textures_;
+  std::vector<std::shared_ptr<Texture>> pending_;
+  std::string cacheDirectory_;
+  std::unique_ptr<TextureTileCache> cache_;
+
+  // converts or reuses the tile file of 'texture' and makes it paged
+  bool loadPaged(Texture &texture, const std::string &pngPath, uint32_t id, std::string &outError);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "util/heap_guard.h"
+
+#ifdef RAYTRACER_HEAP_GUARD
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local const char *guarded = nullptr; // innermost HeapGuard of this thread
+thread_local int permits = 0;
+
+void check(std::size_t size) {
+  if (!guarded || permits > 0)
+    return;
+  const char *where = guarded;
+  guarded = nullptr; // reporting may allocate
+  std::fprintf(stderr, "heap guard: %zu byte allocation inside %s\n", size, where);
+  std::abort();
+}
+
+void *allocate(std::size_t size) {
+  check(size);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t align) {
+  check(size);
+  const std::size_t a = static_cast<std::size_t>(align);
+  if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a))
+    return p;
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+HeapGuard::HeapGuard(const char *where) : previous_(guarded) {
+  guarded = where;
+}
+
+HeapGuard::~HeapGuard() {
+  guarded = previous_;
+}
+
+HeapPermit::HeapPermit() {
+  ++permits;
+}
+
+HeapPermit::~HeapPermit() {
+  --permits;
+}
+
+void *operator new(std::size_t size) {
+  return allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+  return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+  return allocateAligned(size, align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+  return allocateAligned(size, align);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef UTIL_HEAP_GUARD_H
+#define UTIL_HEAP_GUARD_H
+
+// Debug check that render threads stay off the global heap inside the tile loop.
+// Configured with -DRAYTRACER_HEAP_GUARD=ON the global operator new is replaced and aborts
+// when the calling thread is inside a HeapGuard scope, unless a HeapPermit is active for
+// allocations that are expected there (texture tile misses, streamed rows, scratch arena
+// growth). In normal builds both classes are empty.
+#ifdef RAYTRACER_HEAP_GUARD
+
+class HeapGuard {
+public:
+  // 'where' names the guarded region in the abort message
+  explicit HeapGuard(const char *where);
+  ~HeapGuard();
+  HeapGuard(const HeapGuard &) = delete;
+  HeapGuard &operator=(const HeapGuard &) = delete;
+
+private:
+  const char *previous_;
+};
+
+class HeapPermit {
+public:
+  HeapPermit();
+  ~HeapPermit();
+  HeapPermit(const HeapPermit &) = delete;
+  HeapPermit &operator=(const HeapPermit &) = delete;
+};
+
+#else
+
+class HeapGuard {
+public:
+  explicit HeapGuard(const char *) {}
+};
+
+class HeapPermit {
+public:
+  HeapPermit() {}
+};
+
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#include "util/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+  if (data_)
+    ::munmap(data_, size_);
+}
+
+bool MappedFile::open(const std::string &path, std::string &outError) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    outError = "Cannot open " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    outError = "Cannot read " + path + " (missing or empty).";
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    outError = "Cannot map " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  // read front to back once
+  ::madvise(p, size_, MADV_SEQUENTIAL);
+  data_ = p;
+  return true;
+}
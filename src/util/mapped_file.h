@@ -0,0 +1,30 @@
+#ifndef UTIL_MAPPED_FILE_H
+#define UTIL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  // fails for empty files, which cannot be mapped
+  bool open(const std::string &path, std::string &outError);
+
+  const unsigned char *data() const {
+    return static_cast<const unsigned char *>(data_);
+  }
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif
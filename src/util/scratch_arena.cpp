@@ -0,0 +1,31 @@
+#include "util/scratch_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "util/heap_guard.h"
+
+ScratchArena::ScratchArena(size_t blockBytes) : blockBytes_(blockBytes) {
+  blocks_.push_back({std::make_unique<std::byte[]>(blockBytes_), blockBytes_});
+}
+
+void *ScratchArena::allocate(size_t bytes, size_t align) {
+  for (;;) {
+    Block &block = blocks_[block_];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    const uintptr_t aligned = (base + offset_ + align - 1) & ~(uintptr_t(align) - 1);
+    if (aligned + bytes <= base + block.size) {
+      offset_ = aligned + bytes - base;
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    // continue in the next retained block or grow; a block always fits the request
+    ++block_;
+    offset_ = 0;
+    if (block_ == blocks_.size() || blocks_[block_].size < bytes + align) {
+      HeapPermit growth;
+      const size_t size = std::max(blockBytes_, bytes + align);
+      blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(block_), {std::make_unique<std::byte[]>(size), size});
+    }
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef UTIL_SCRATCH_ARENA_H
+#define UTIL_SCRATCH_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "util/task_scheduler.h"
+
+// Bump allocator for short-lived memory of one render thread. Allocations are carved out of
+// blocks that are kept for the lifetime of the arena: rewind() and reset() hand the memory
+// out again without freeing, so the heap is only touched while the arena grows to the
+// working set of the first tiles. Nothing is destroyed, only trivially destructible types.
+class alignas(64) ScratchArena {
+public:
+  explicit ScratchArena(size_t blockBytes);
+
+  struct Marker {
+    size_t block;
+    size_t offset;
+  };
+
+  void *allocate(size_t bytes, size_t align);
+
+  template <class T>
+  T *allocateArray(size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>, "scratch memory is never destroyed");
+    return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  Marker mark() const {
+    return {block_, offset_};
+  }
+  // releases everything allocated after 'marker'
+  void rewind(Marker marker) {
+    block_ = marker.block;
+    offset_ = marker.offset;
+  }
+  void reset() {
+    rewind({0, 0});
+  }
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  size_t block_ = 0;
+  size_t offset_ = 0;
+  size_t blockBytes_;
+};
+
+// One ScratchArena per pool thread, like OccluderCache
+class ScratchArenas {
+public:
+  explicit ScratchArenas(size_t blockBytes = size_t{64} << 10) {
+    arenas_.reserve(TaskScheduler::instance().threadCount());
+    for (unsigned i = 0; i < TaskScheduler::instance().threadCount(); ++i)
+      arenas_.emplace_back(blockBytes);
+  }
+
+  // arena of the calling thread, threads outside the pool share the first one
+  ScratchArena &forCurrentThread() const {
+    return arenas_[TaskScheduler::currentThreadIndex()];
+  }
+
+private:
+  mutable std::vector<ScratchArena> arenas_;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "util/snapshot_signal.h"
+
+#include <csignal>
+
+namespace {
+
+volatile std::sig_atomic_t snapshotRequested = 0;
+
+extern "C" void onSnapshotSignal(int) {
+  snapshotRequested = 1;
+}
+
+} // namespace
+
+void installSnapshotSignalHandler() {
+#ifdef SIGUSR1
+  std::signal(SIGUSR1, onSnapshotSignal);
+#endif
+}
+
+bool consumeSnapshotRequest() {
+  if (!snapshotRequested)
+    return false;
+  snapshotRequested = 0;
+  return true;
+}
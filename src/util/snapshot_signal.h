@@ -0,0 +1,11 @@
+#ifndef UTIL_SNAPSHOT_SIGNAL_H
+#define UTIL_SNAPSHOT_SIGNAL_H
+
+// SIGUSR1 requests an intermediate image of a running progressive render
+// ("kill -USR1 <pid>"). Where SIGUSR1 does not exist the handler is a no-op.
+void installSnapshotSignalHandler();
+
+// Returns true (once) if a snapshot was requested since the last call
+bool consumeSnapshotRequest();
+
+#endif
@@ -0,0 +1,161 @@
+#include "util/task_scheduler.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local unsigned tlsThreadIndex = 0;
+
+// Binds a thread to one CPU, silently ignored where not supported
+void pinToCpu(std::thread::native_handle_type handle, unsigned cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+  pthread_setaffinity_np(handle, sizeof(set), &set);
+#else
+  (void)handle;
+  (void)cpu;
+#endif
+}
+
+} // namespace
+
+TaskScheduler &TaskScheduler::instance() {
+  static TaskScheduler scheduler;
+  return scheduler;
+}
+
+TaskScheduler::TaskScheduler() {
+  configure(0, false);
+}
+
+TaskScheduler::~TaskScheduler() {
+  shutdown();
+}
+
+unsigned TaskScheduler::currentThreadIndex() {
+  return tlsThreadIndex;
+}
+
+void TaskScheduler::configure(unsigned threadCount, bool pinThreads) {
+  shutdown();
+
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  queues_.clear();
+  for (unsigned i = 0; i < threadCount; ++i)
+    queues_.push_back(std::make_unique<WorkQueue>());
+
+  stopping_ = false;
+  for (unsigned i = 1; i < threadCount; ++i) {
+    workers_.emplace_back(&TaskScheduler::workerLoop, this, i);
+    if (pinThreads)
+      pinToCpu(workers_.back().native_handle(), i);
+  }
+#ifdef __linux__
+  if (pinThreads)
+    pinToCpu(pthread_self(), 0);
+#endif
+}
+
+void TaskScheduler::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &t : workers_)
+    t.join();
+  workers_.clear();
+}
+
+void TaskScheduler::push(Task task) {
+  WorkQueue &q = *queues_[tlsThreadIndex];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+  queued_.fetch_add(1, std::memory_order_release);
+  {
+    // pairs with the predicate check in workerLoop so a wakeup cannot be lost
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  wake_.notify_one();
+}
+
+bool TaskScheduler::tryRunOne() {
+  const unsigned self = tlsThreadIndex;
+  const unsigned n = threadCount();
+  Task task;
+  bool found = false;
+
+  // own deque: newest first (depth first, cache friendly)
+  {
+    WorkQueue &q = *queues_[self];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+      found = true;
+    }
+  }
+
+  // steal the oldest (typically largest) task of another thread
+  for (unsigned i = 1; !found && i < n; ++i) {
+    WorkQueue &q = *queues_[(self + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (!q.tasks.empty()) {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      found = true;
+    }
+  }
+
+  if (!found)
+    return false;
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  execute(task);
+  return true;
+}
+
+void TaskScheduler::waitForTaskOrZero(const std::atomic<size_t> &pending) {
+  std::unique_lock<std::mutex> lock(sleepMutex_);
+  wake_.wait(lock, [&] {
+    return pending.load(std::memory_order_acquire) == 0 || queued_.load(std::memory_order_acquire) > 0;
+  });
+}
+
+void TaskScheduler::notifyGroupDone() {
+  {
+    // same handshake as in push()
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  wake_.notify_all();
+}
+
+void TaskScheduler::execute(Task &task) {
+  std::exception_ptr error;
+  try {
+    task.fn();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  task.group->finished(error);
+}
+
+void TaskScheduler::workerLoop(unsigned index) {
+  tlsThreadIndex = index;
+  for (;;) {
+    if (tryRunOne())
+      continue;
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_acquire) > 0; });
+    if (stopping_)
+      return;
+  }
+}
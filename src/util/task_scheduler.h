@@ -0,0 +1,158 @@
+#ifndef UTIL_TASK_SCHEDULER_H
+#define UTIL_TASK_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+// Process wide work-stealing scheduler. Every thread of the pool owns a deque: it pushes and
+// pops work at the back, idle threads steal from the front of the other deques. The thread
+// that configured the scheduler (main) is worker 0 and executes tasks while it waits.
+// All parallel work (OBJ loading, BVH builds, texture decoding, rendering) goes through here.
+class TaskScheduler {
+public:
+  static TaskScheduler &instance();
+
+  // (Re)starts the pool with 'threadCount' threads including the caller (0 = hardware
+  // concurrency). With 'pinThreads' thread i is bound to CPU i. Must not be called while work is running.
+  void configure(unsigned threadCount, bool pinThreads);
+
+  unsigned threadCount() const {
+    return static_cast<unsigned>(queues_.size());
+  }
+
+  // pool index of the calling thread, threads outside the pool share index 0
+  static unsigned currentThreadIndex();
+
+  // Runs one queued task if there is any and returns without waiting otherwise. Long running
+  // loops call this between their work items, so small tasks forked meanwhile (e.g. PNG
+  // bands) run interleaved with the loop instead of after it.
+  bool runPendingTask() {
+    return queued_.load(std::memory_order_relaxed) > 0 && tryRunOne();
+  }
+
+  ~TaskScheduler();
+
+private:
+  friend class TaskGroup;
+
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup *group = nullptr;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  TaskScheduler();
+
+  void push(Task task);
+  // runs one task from the own deque or stolen from another one, false if all are empty
+  bool tryRunOne();
+  // sleeps until a task is queued or 'pending' (a group's task count) drops to zero
+  void waitForTaskOrZero(const std::atomic<size_t> &pending);
+  // wakes the threads in waitForTaskOrZero() after a group's last task finished
+  void notifyGroupDone();
+  void execute(Task &task);
+  void workerLoop(unsigned index);
+  void shutdown();
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  std::atomic<size_t> queued_{0};
+  bool stopping_ = false;
+};
+
+// Fork/join helper: run() forks tasks, wait() joins them while helping with pending work.
+// The first exception thrown by a task is rethrown from wait().
+class TaskGroup {
+public:
+  TaskGroup() : scheduler_(TaskScheduler::instance()) {}
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  ~TaskGroup() {
+    drain();
+  }
+
+  template <typename F>
+  void run(F &&fn) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    scheduler_.push({std::function<void()>(std::forward<F>(fn)), this});
+  }
+
+  void wait() {
+    drain();
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    if (error_) {
+      std::exception_ptr e = error_;
+      error_ = nullptr;
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  friend class TaskScheduler;
+
+  // helps with queued work and sleeps while the remaining tasks run on other threads
+  void drain() {
+    while (pending_.load(std::memory_order_acquire) > 0) {
+      if (!scheduler_.tryRunOne())
+        scheduler_.waitForTaskOrZero(pending_);
+    }
+  }
+
+  void finished(std::exception_ptr e) {
+    if (e) {
+      std::lock_guard<std::mutex> lock(errorMutex_);
+      if (!error_)
+        error_ = e;
+    }
+    // the group may be destroyed as soon as pending_ reaches zero
+    TaskScheduler &scheduler = scheduler_;
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      scheduler.notifyGroupDone();
+  }
+
+  TaskScheduler &scheduler_;
+  std::atomic<size_t> pending_{0};
+  std::mutex errorMutex_;
+  std::exception_ptr error_;
+};
+
+// Calls body(chunkBegin, chunkEnd) for consecutive chunks of at most 'grain' indices of
+// [begin, end) in parallel and returns when all of them are done
+template <typename F>
+void parallelFor(size_t begin, size_t end, size_t grain, F &&body) {
+  if (end <= begin)
+    return;
+  grain = std::max<size_t>(1, grain);
+  if (end - begin <= grain || TaskScheduler::instance().threadCount() <= 1) {
+    body(begin, end);
+    return;
+  }
+
+  TaskGroup group;
+  for (size_t b = begin; b < end; b += grain) {
+    const size_t e = std::min(end, b + grain);
+    group.run([&body, b, e] { body(b, e); });
+  }
+  group.wait();
+}
+
+#endif